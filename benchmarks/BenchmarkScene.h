@@ -0,0 +1,113 @@
+﻿// Fixed scene shared by the renderer benchmarks: the same primitives on every run and
+// platform, whichever IRenderer draws them.
+#pragma once
+#include "IRenderer.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BenchmarkScene
+{
+    // Same sequence on every run and platform
+    class Random
+    {
+    public:
+        float next(float low, float high)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            return low + (high - low) * static_cast<float>(state >> 40) / static_cast<float>(1 << 24);
+        }
+
+    private:
+        uint64_t state = 0x853C49E6748FEA9Bull;
+    };
+
+    // Solid shapes, concave polygons, curves, strokes and gradients across the canvas.
+    // Returns the number of primitives drawn.
+    inline int drawScene(IRenderer& renderer, int width, int height)
+    {
+        Random random;
+        const float w = static_cast<float>(width), h = static_cast<float>(height);
+        int primitives = 0;
+
+        renderer.drawLinearGradient("sky", { 0.0f, 0.0f }, { w, h }, { { 0.0f, "#1e90ff" }, { 1.0f, "#ffd700" } });
+        renderer.drawRadialGradient("glow", { w / 2, h / 2 }, h / 2, { { 0.0f, "#ffffff" }, { 1.0f, "#ff4500" } });
+        renderer.setFillGradient("sky");
+        renderer.setStrokeColor(0, 0, 0, 0);
+        renderer.drawRectangle(0.0f, 0.0f, w, h);
+        ++primitives;
+
+        auto colour = [&](int alpha) {
+            renderer.setFillColor(static_cast<int>(random.next(0, 255)), static_cast<int>(random.next(0, 255)),
+                static_cast<int>(random.next(0, 255)), alpha);
+        };
+
+        for (int i = 0; i < 400; ++i) {
+            colour(200);
+            renderer.drawRectangle(random.next(0, w), random.next(0, h), random.next(4, 120), random.next(4, 120));
+            colour(160);
+            renderer.drawCircle(random.next(0, w), random.next(0, h), random.next(2, 60));
+            colour(255);
+            renderer.drawEllipse(random.next(0, w), random.next(0, h), random.next(2, 80), random.next(2, 40));
+            colour(128);
+            const float x = random.next(0, w), y = random.next(0, h);
+            renderer.drawTriangle(x, y, x + random.next(-80, 80), y + random.next(-80, 80),
+                x + random.next(-80, 80), y + random.next(-80, 80));
+            primitives += 4;
+        }
+
+        // Concave stars, alternately nonzero and even-odd
+        std::vector<Point2D> star(10);
+        for (int i = 0; i < 200; ++i) {
+            const float cx = random.next(0, w), cy = random.next(0, h), r = random.next(10, 90);
+            for (int k = 0; k < 10; ++k) {
+                const float angle = static_cast<float>(k) * 0.6283185f, radius = (k % 2) ? r * 0.4f : r;
+                star[k] = { cx + radius * std::sin(angle), cy - radius * std::cos(angle) };
+            }
+            colour(220);
+            renderer.setFillRule(i % 2 ? FillRule::EvenOdd : FillRule::NonZero);
+            renderer.drawPolygon(star);
+            ++primitives;
+        }
+        renderer.setFillRule(FillRule::NonZero);
+
+        // Curved paths, filled and stroked
+        renderer.setStrokeColor(20, 20, 20, 255);
+        renderer.setStrokeWidth(2.0f);
+        for (int i = 0; i < 200; ++i) {
+            const float x = random.next(0, w), y = random.next(0, h), s = random.next(20, 150);
+            std::string d = "M" + std::to_string(x) + " " + std::to_string(y)
+                + " c" + std::to_string(s) + " " + std::to_string(-s) + " " + std::to_string(2 * s) + " " + std::to_string(s) + " " + std::to_string(s) + " " + std::to_string(s / 2)
+                + " q" + std::to_string(-s) + " " + std::to_string(s) + " " + std::to_string(-s) + " 0 z";
+            colour(180);
+            renderer.drawPath(d);
+            ++primitives;
+        }
+
+        // Stroked polylines and lines
+        std::vector<Point2D> line(16);
+        for (int i = 0; i < 200; ++i) {
+            float x = random.next(0, w), y = random.next(0, h);
+            for (Point2D& point : line) {
+                point = { x, y };
+                x += random.next(-40, 40);
+                y += random.next(-40, 40);
+            }
+            renderer.setStrokeColor(static_cast<int>(random.next(0, 255)), 0, 0, 255);
+            renderer.setStrokeWidth(random.next(1, 6));
+            renderer.drawPolyline(line);
+            renderer.drawLine({ x, y }, { x + random.next(-200, 200), y + random.next(-200, 200) });
+            primitives += 2;
+        }
+
+        // Gradient-filled circles
+        renderer.setStrokeColor(0, 0, 0, 0);
+        renderer.setFillGradient("glow");
+        for (int i = 0; i < 100; ++i) {
+            renderer.drawCircle(random.next(0, w), random.next(0, h), random.next(10, 100));
+            ++primitives;
+        }
+        return primitives;
+    }
+}
@@ -0,0 +1,87 @@
+﻿// Throughput of the compositing kernels at every SIMD level this CPU supports, in megapixels
+// per second. Usage: CompositingBenchmark [megapixels per measurement]
+#include "Compositing.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    const SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+    // About the width of a scanline span, so per-call overhead counts as it does when rasterising
+    const int SpanLength = 256;
+    const int SpanCount = 64;
+
+    // Same sequence on every run and platform
+    uint32_t nextRandom(uint64_t& state)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<uint32_t>(state >> 32);
+    }
+
+    struct Buffers {
+        std::vector<uint32_t> dst, src;
+        std::vector<uint8_t> coverage;
+        uint32_t colour = premultiplyColour(0x3090E0C0);
+
+        // 'mixed': anti-aliased edges and holes; otherwise every pixel fully covered
+        Buffers(bool mixed) : dst(SpanLength * SpanCount), src(dst.size()), coverage(dst.size())
+        {
+            uint64_t state = 0x853C49E6748FEA9Bull;
+            for (size_t i = 0; i < dst.size(); ++i) {
+                const uint32_t alpha = nextRandom(state) & 0xFF;
+                const uint32_t grey = alpha / 2;
+                src[i] = alpha << 24 | grey << 16 | grey << 8 | grey;
+                dst[i] = 0xFF000000 | (nextRandom(state) & 0x00FFFFFF);
+                const uint32_t pick = nextRandom(state) % 4;
+                coverage[i] = !mixed ? 255 : static_cast<uint8_t>(pick == 0 ? 0 : pick == 1 ? 255 : nextRandom(state) & 0xFF);
+            }
+        }
+    };
+
+    template <typename Kernel>
+    double measure(double megapixels, Buffers& buffers, Kernel kernel)
+    {
+        const long pixelsPerPass = SpanLength * SpanCount;
+        const long passes = static_cast<long>(megapixels * 1e6 / pixelsPerPass) + 1;
+        const auto start = std::chrono::steady_clock::now();
+        for (long pass = 0; pass < passes; ++pass) {
+            for (int span = 0; span < SpanCount; ++span)
+                kernel(buffers, span * SpanLength);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return passes * pixelsPerPass / seconds / 1e6;
+    }
+
+    void solid(Buffers& b, int offset)
+    {
+        compositeSolidSpan(b.dst.data() + offset, SpanLength, b.colour, b.coverage.data() + offset);
+    }
+
+    void span(Buffers& b, int offset)
+    {
+        compositeSpan(b.dst.data() + offset, SpanLength, b.src.data() + offset, b.coverage.data() + offset);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const double megapixels = argc > 1 ? std::atof(argv[1]) : 200.0;
+    const SimdLevel detected = detectSimdLevel();
+    Buffers full(false), mixed(true);
+
+    std::printf("%-8s %16s %16s %16s %16s   (Mpixel/s)\n", "level", "solid full", "solid mixed", "span full", "span mixed");
+    for (SimdLevel level : Levels) {
+        if (!setCompositingLevel(level)) {
+            std::printf("%-8s not available on this CPU or build\n", simdLevelName(level));
+            continue;
+        }
+        std::printf("%-8s %16.0f %16.0f %16.0f %16.0f\n", simdLevelName(level),
+            measure(megapixels, full, solid), measure(megapixels, mixed, solid),
+            measure(megapixels, full, span), measure(megapixels, mixed, span));
+    }
+    setCompositingLevel(detected);
+    return 0;
+}
@@ -0,0 +1,57 @@
+﻿// Throughput of RasterRenderer on a fixed scene, in megapixels and primitives per second.
+// Usage: RasterBenchmark [frames] [width] [height]
+#include "RasterRenderer.h"
+#include "BenchmarkScene.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void run(const char* mode, bool tiled, unsigned threads, int frames, int width, int height)
+    {
+        RasterRenderer renderer;
+        renderer.setTiledRendering(tiled, threads);
+        int primitives = 0;
+        uint64_t checksum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            renderer.initialize(width, height);
+            primitives = BenchmarkScene::drawScene(renderer, width, height);
+            const std::vector<uint32_t>& pixels = renderer.getPixels(); // Rasterises a tiled frame
+            checksum += pixels[pixels.size() / 2];
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double megapixels = static_cast<double>(width) * height * frames / 1e6;
+        std::printf("%-22s %8.1f ms/frame %10.1f Mpixel/s %12.0f primitives/s  (checksum %llx)\n", mode,
+            seconds * 1000.0 / frames, megapixels / seconds, static_cast<double>(primitives) * frames / seconds,
+            static_cast<unsigned long long>(checksum));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 10;
+    const int width = argc > 2 ? std::atoi(argv[2]) : 1920;
+    const int height = argc > 3 ? std::atoi(argv[3]) : 1080;
+    if (frames <= 0 || width <= 0 || height <= 0) {
+        std::fprintf(stderr, "usage: %s [frames] [width] [height]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%d frames of %dx%d\n", frames, width, height);
+    run("immediate", false, 1, frames, width, height);
+    run("tiled, 1 thread", true, 1, frames, width, height);
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > 1)
+        run(("tiled, " + std::to_string(threads) + " threads").c_str(), true, threads, frames, width, height);
+    return 0;
+}
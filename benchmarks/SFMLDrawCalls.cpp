@@ -0,0 +1,48 @@
+﻿// renderTexture.draw calls and frame time of SFMLRenderer on the benchmark scene, with and
+// without batching. Needs an OpenGL context; on a headless machine run it under Xvfb, where
+// Mesa's software GL (llvmpipe) does the drawing.
+// Usage: SFMLDrawCalls [frames] [width] [height]
+#include "SFMLRenderer.h"
+#include "BenchmarkScene.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+    void run(const char* mode, bool batching, int frames, int width, int height)
+    {
+        SFMLRenderer renderer;
+        renderer.setBatching(batching);
+        int primitives = 0;
+        unsigned drawCalls = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            renderer.initialize(width, height);
+            primitives = BenchmarkScene::drawScene(renderer, width, height);
+            renderer.flush();
+            drawCalls = renderer.getDrawCallCount();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("%-12s %6d primitives %8u draw calls %8.1f ms/frame\n", mode, primitives, drawCalls,
+            seconds * 1000.0 / frames);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 10;
+    const int width = argc > 2 ? std::atoi(argv[2]) : 1920;
+    const int height = argc > 3 ? std::atoi(argv[3]) : 1080;
+    if (frames <= 0 || width <= 0 || height <= 0) {
+        std::fprintf(stderr, "usage: %s [frames] [width] [height]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%d frames of %dx%d\n", frames, width, height);
+    run("unbatched", false, frames, width, height);
+    run("batched", true, frames, width, height);
+    return 0;
+}
@@ -0,0 +1,122 @@
+﻿#include "AttributeCache.h"
+#include "ColorUtils.h"
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+namespace SVGParser
+{
+    AttributeCache::AttributeCache(size_t capacity) : m_capacity(capacity) {}
+
+    void AttributeCache::setCapacity(size_t capacity) {
+        m_capacity = capacity;
+        clear();
+    }
+
+    size_t AttributeCache::getCapacity() const {
+        return m_capacity;
+    }
+
+    void AttributeCache::clear() {
+        m_colours.clear();
+        m_numbers.clear();
+        m_transforms.clear();
+        m_colourStats = AttributeCacheStats();
+        m_numberStats = AttributeCacheStats();
+        m_transformStats = AttributeCacheStats();
+    }
+
+    size_t AttributeCache::KeyHash::operator()(const Key& key) const {
+        // Eight bytes per multiply-xorshift step: transforms and paths run to dozens of characters
+        uint64_t hash = key.size * 0x9E3779B97F4A7C15ull;
+        const char* data = key.data;
+        size_t remaining = key.size;
+        for (; remaining >= 8; data += 8, remaining -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 32;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, data, remaining);
+        hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ull;
+        return static_cast<size_t>(hash ^ (hash >> 29));
+    }
+
+    unsigned long AttributeCache::colour(const char* raw, unsigned long fallback) {
+        const Key key(raw);
+        if (const ColourEntry* cached = m_colours.find(key)) {
+            ++m_colourStats.hits;
+            return cached->valid ? cached->colour : fallback;
+        }
+
+        ++m_colourStats.misses;
+        // Remember whether the text was understood, so the entry is valid for any fallback
+        ColourEntry entry{ false, 0 };
+        entry.valid = tryParseColorString(std::string(raw, key.size), entry.colour);
+        if (m_colours.size() < m_capacity) {
+            m_colours.insert(key, entry);
+        }
+        else {
+            ++m_colourStats.uncached;
+        }
+        return entry.valid ? entry.colour : fallback;
+    }
+
+    float AttributeCache::number(const char* raw) {
+        const Key key(raw);
+        if (const float* cached = m_numbers.find(key)) {
+            ++m_numberStats.hits;
+            return *cached;
+        }
+
+        ++m_numberStats.misses;
+        float value = std::strtof(raw, nullptr);
+        if (m_numbers.size() < m_capacity) {
+            m_numbers.insert(key, value);
+        }
+        else {
+            ++m_numberStats.uncached;
+        }
+        return value;
+    }
+
+    const Transform& AttributeCache::transform(const char* raw) {
+        const Key key(raw);
+        if (const Transform* cached = m_transforms.find(key)) {
+            ++m_transformStats.hits;
+            return *cached;
+        }
+
+        ++m_transformStats.misses;
+        if (m_transforms.size() < m_capacity) {
+            // References into an unordered_map stay valid while it grows
+            return m_transforms.insert(key, Transform::fromString(raw));
+        }
+        ++m_transformStats.uncached;
+        m_scratchTransform = Transform::fromString(raw);
+        return m_scratchTransform;
+    }
+
+    const AttributeCacheStats& AttributeCache::colourStats() const {
+        return m_colourStats;
+    }
+
+    const AttributeCacheStats& AttributeCache::numberStats() const {
+        return m_numberStats;
+    }
+
+    const AttributeCacheStats& AttributeCache::transformStats() const {
+        return m_transformStats;
+    }
+
+    AttributeCacheStats AttributeCache::totalStats() const {
+        AttributeCacheStats total;
+        for (const AttributeCacheStats* stats : { &m_colourStats, &m_numberStats, &m_transformStats }) {
+            total.hits += stats->hits;
+            total.misses += stats->misses;
+            total.uncached += stats->uncached;
+        }
+        return total;
+    }
+} // namespace SVGParser
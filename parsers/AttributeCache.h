@@ -0,0 +1,100 @@
+﻿#ifndef ATTRIBUTE_CACHE_H
+#define ATTRIBUTE_CACHE_H
+
+#include <string>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include "../src/elements/Transform.h"
+
+namespace SVGParser
+{
+    // Hit/miss counters of one kind of memoised value
+    struct AttributeCacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t uncached = 0; // Misses that were not stored because the table was full
+
+        size_t lookups() const { return hits + misses; }
+        double hitRate() const { return lookups() ? static_cast<double>(hits) / lookups() : 0.0; }
+    };
+
+    // Per-parse memo table: raw attribute text -> parsed value, for colours, transforms and numbers.
+    // Exported drawings repeat the same few values over and over, so most lookups skip parsing.
+    class AttributeCache {
+    public:
+        // Default number of entries kept per kind of value
+        static const size_t DefaultCapacity = 4096;
+
+        explicit AttributeCache(size_t capacity = DefaultCapacity);
+
+        // Maximum entries per kind of value; 0 disables memoisation. Once a table is full
+        // new values are still parsed, just not remembered (the first values seen are the common ones).
+        void setCapacity(size_t capacity);
+        size_t getCapacity() const;
+
+        // Forget every value and reset the statistics (called at the start of each parse)
+        void clear();
+
+        // Colour as 0xRRGGBBAA, 'fallback' for values parseColorString does not understand
+        unsigned long colour(const char* raw, unsigned long fallback);
+        float number(const char* raw);
+        const Transform& transform(const char* raw);
+
+        const AttributeCacheStats& colourStats() const;
+        const AttributeCacheStats& numberStats() const;
+        const AttributeCacheStats& transformStats() const;
+
+        // All kinds together
+        AttributeCacheStats totalStats() const;
+
+    private:
+        struct ColourEntry {
+            bool valid;
+            unsigned long colour;
+        };
+
+        // Attribute text looked up in place: a hit allocates nothing
+        struct Key {
+            const char* data;
+            size_t size;
+
+            explicit Key(const char* text) : data(text), size(std::strlen(text)) {}
+            bool operator==(const Key& other) const {
+                return size == other.size && std::memcmp(data, other.data, size) == 0;
+            }
+        };
+        struct KeyHash {
+            size_t operator()(const Key& key) const;
+        };
+
+        // Memo table of one kind of value. The keys point into 'text', whose strings never
+        // move once added.
+        template <typename Value>
+        struct Table {
+            std::unordered_map<Key, Value, KeyHash> entries;
+            std::deque<std::string> text;
+
+            Value* find(const Key& key) {
+                auto it = entries.find(key);
+                return it != entries.end() ? &it->second : nullptr;
+            }
+            Value& insert(const Key& key, const Value& value) {
+                text.emplace_back(key.data, key.size);
+                return entries.emplace(Key(text.back().c_str()), value).first->second;
+            }
+            size_t size() const { return entries.size(); }
+            void clear() { entries.clear(); text.clear(); }
+        };
+
+        size_t m_capacity;
+        Table<ColourEntry> m_colours;
+        Table<float> m_numbers;
+        Table<Transform> m_transforms;
+        AttributeCacheStats m_colourStats, m_numberStats, m_transformStats;
+        Transform m_scratchTransform; // Result of an uncached transform lookup
+    };
+} // namespace SVGParser
+
+#endif // ATTRIBUTE_CACHE_H
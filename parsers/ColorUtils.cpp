@@ -3,6 +3,15 @@
 
 unsigned long parseColorString(const std::string& str, unsigned long fallback)
 {
+    unsigned long colour = fallback;
+    tryParseColorString(str, colour);
+    return colour;
+}
+
+bool tryParseColorString(const std::string& str, unsigned long& out)
+{
+    if (str.empty()) return false;
+
     // Handle hex: "#rrggbb"
     if (str[0] == '#' && (str.length() == 7 || str.length() == 4)) {
         unsigned int r = 0, g = 0, b = 0;
@@ -17,21 +26,29 @@ unsigned long parseColorString(const std::string& str, unsigned long fallback)
             g = std::stoi(str.substr(2, 1), nullptr, 16) * 17;
             b = std::stoi(str.substr(3, 1), nullptr, 16) * 17;
         }
-        return (r << 24) | (g << 16) | (b << 8) | 0xFF;
+        out = (r << 24) | (g << 16) | (b << 8) | 0xFF;
+        return true;
     }
 
     // Handle rgb(...) syntax
-    std::regex rgbRegex(R"(rgb\s*\(\s*(\d+)[,\s]+(\d+)[,\s]+(\d+)\s*\))");
+    static const std::regex rgbRegex(R"(rgb\s*\(\s*(\d+)[,\s]+(\d+)[,\s]+(\d+)\s*\))");
     std::smatch match;
     if (std::regex_match(str, match, rgbRegex)) {
         int r = std::stoi(match[1]);
         int g = std::stoi(match[2]);
         int b = std::stoi(match[3]);
-        return (r << 24) | (g << 16) | (b << 8) | 0xFF;
+        out = (r << 24) | (g << 16) | (b << 8) | 0xFF;
+        return true;
+    }
+
+    // "none" and "transparent" paint nothing: fully transparent
+    if (str == "none" || str == "transparent") {
+        out = 0x00000000;
+        return true;
     }
 
     // Handle named colours (e.g., "red", "black")
-    static std::unordered_map<std::string, unsigned long> namedColours = {
+    static const std::unordered_map<std::string, unsigned long> namedColours = {
         {"black", 0x000000FF}, {"white", 0xFFFFFFFF}, {"red", 0xFF0000FF},
         {"green", 0x00FF00FF}, {"blue", 0x0000FFFF}, {"yellow", 0xFFFF00FF},
         {"cyan", 0x00FFFFFF}, {"magenta", 0xFF00FFFF}
@@ -39,10 +56,13 @@ unsigned long parseColorString(const std::string& str, unsigned long fallback)
     };
 
     auto it = namedColours.find(str);
-    if (it != namedColours.end()) return it->second;
+    if (it != namedColours.end()) {
+        out = it->second;
+        return true;
+    }
 
-    // Unknown format → return fallback
-    return fallback;
+    // Unknown format → caller keeps its fallback
+    return false;
 }
 
 void getRGBAFromULong(unsigned long colour, int& r, int& g, int& b, int& a)
@@ -10,6 +10,9 @@
 // Chuyển chuỗi màu SVG thành unsigned long kiểu 0xRRGGBBAA
 unsigned long parseColorString(const std::string& str, unsigned long fallback = 0x000000FF);
 
+// Như trên nhưng báo lại chuỗi có hợp lệ không (false: out không đổi)
+bool tryParseColorString(const std::string& str, unsigned long& out);
+
 // Nếu cần: các hàm đã có
 void getRGBAFromULong(unsigned long colour, int& r, int& g, int& b, int& a);
 std::string rgbaToSVGColour(unsigned long colour);
@@ -4,6 +4,10 @@
 #include <sstream>
 #include <algorithm> // For std::remove
 #include <map>       // For named colours in parseColorString (if used)
+#include <cstdlib>   // For std::strtof
+#include <unordered_set>
+#include "ColorUtils.h"
+#include "Diagnostics.h"
 
 // Using declarations to simplify code within the namespace
 using pugi::xml_node;
@@ -21,6 +25,118 @@ namespace SVGParser
         return str.substr(first, (last - first + 1));
     }
 
+    // Helper function to extract "id" from a "url(#id)" reference, empty if the value is not one
+    std::string parseUrlReference(const std::string& value) {
+        std::string str = trim(value);
+        if (str.compare(0, 4, "url(") != 0) {
+            return "";
+        }
+        size_t close = str.find(')', 4);
+        if (close == std::string::npos) {
+            return "";
+        }
+        std::string ref = trim(str.substr(4, close - 4));
+        if (ref.size() >= 2 && (ref.front() == '\'' || ref.front() == '"') && ref.back() == ref.front()) {
+            ref = ref.substr(1, ref.size() - 2);
+        }
+        if (ref.empty() || ref[0] != '#') {
+            return "";
+        }
+        return ref.substr(1);
+    }
+
+    // Helper function to read a number that may be given as a percentage ("50%" -> 0.5)
+    float parseNumberOrPercentage(const std::string& value, float defaultValue) {
+        std::string str = trim(value);
+        if (str.empty()) {
+            return defaultValue;
+        }
+        char* end = nullptr;
+        float number = std::strtof(str.c_str(), &end);
+        if (end == str.c_str()) {
+            return defaultValue;
+        }
+        return (*end == '%') ? number / 100.0f : number;
+    }
+
+    // Helper function to read a property from an attribute, or else from the inline style attribute
+    std::string getPresentationValue(const xml_node& xmlNode, const char* name) {
+        xml_attribute attr = xmlNode.attribute(name);
+        if (attr) {
+            return attr.value();
+        }
+
+        std::string style = xmlNode.attribute("style").value();
+        std::string key = std::string(name) + ":";
+        std::stringstream ss(style);
+        std::string declaration;
+        while (std::getline(ss, declaration, ';')) {
+            declaration = trim(declaration);
+            if (declaration.compare(0, key.size(), key) == 0) {
+                return trim(declaration.substr(key.size()));
+            }
+        }
+        return "";
+    }
+
+    // Helper function to read stroke-linecap/-linejoin/-miterlimit/-dasharray/-dashoffset;
+    // invalid values keep the initial value
+    StrokeStyle parseStrokeStyle(const xml_node& xmlNode) {
+        StrokeStyle style;
+        std::string cap = getPresentationValue(xmlNode, "stroke-linecap");
+        if (cap == "round") {
+            style.cap = LineCap::Round;
+        }
+        else if (cap == "square") {
+            style.cap = LineCap::Square;
+        }
+
+        std::string join = getPresentationValue(xmlNode, "stroke-linejoin");
+        if (join == "round") {
+            style.join = LineJoin::Round;
+        }
+        else if (join == "bevel") {
+            style.join = LineJoin::Bevel;
+        }
+
+        float miterLimit = parseNumberOrPercentage(getPresentationValue(xmlNode, "stroke-miterlimit"), 4.0f);
+        if (miterLimit >= 1.0f) {
+            style.miterLimit = miterLimit;
+        }
+
+        std::string dashes = getPresentationValue(xmlNode, "stroke-dasharray");
+        if (!dashes.empty() && dashes != "none") {
+            std::replace(dashes.begin(), dashes.end(), ',', ' ');
+            std::stringstream ss(dashes);
+            float dash;
+            while (ss >> dash) {
+                style.dashArray.push_back(dash);
+            }
+            if (!ss.eof()) {
+                SVG_WARN("SVGParser: Invalid stroke-dasharray: " << dashes);
+                style.dashArray.clear();
+            }
+        }
+        style.dashOffset = parseNumberOrPercentage(getPresentationValue(xmlNode, "stroke-dashoffset"), 0.0f);
+        return style;
+    }
+
+    // Elements that never render by themselves (or are not supported): their subtree is skipped whole
+    bool isNonRenderingElement(const std::string& nodeName) {
+        static const char* const names[] = {
+            "metadata", "title", "desc", "style", "script", "foreignObject",
+            "clipPath", "mask", "marker", "pattern", "filter", "cursor", "view"
+        };
+        for (const char* name : names) {
+            if (nodeName == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char* const SVGNamespace = "http://www.w3.org/2000/svg";
+
     SVGParser::SVGParser() {}
 
     SVGParser::~SVGParser() {
@@ -29,6 +145,11 @@ namespace SVGParser
 
     bool SVGParser::parse(const std::string& source, bool isFilePath) {
         clearElements(); // Clear elements before parsing
+        m_xmlParser.getAttributeCache().clear(); // The memo is per document
+        m_eliminationStats = EliminationStats();
+        m_skipStats = SkipStats();
+        m_definitionDepth = 0;
+        Diagnostics::current().beginDocument(isFilePath ? source : std::string("<string>"));
 
         bool success = false;
         if (isFilePath) {
@@ -39,12 +160,14 @@ namespace SVGParser
         }
 
         if (!success) {
+            Diagnostics::current().endDocument();
             return false;
         }
 
         xml_node svgNode = m_xmlParser.getRootNode();
         if (!svgNode) {
-            std::cerr << "SVGParser: Could not find root <svg> element." << std::endl;
+            SVG_ERROR("SVGParser: Could not find root <svg> element.");
+            Diagnostics::current().endDocument();
             return false;
         }
 
@@ -54,6 +177,16 @@ namespace SVGParser
                 m_svgElements.push_back(std::move(element));
             }
         }
+
+        resolveReferences();
+        for (SVGGradient* gradient : m_gradients) {
+            gradient->finalize();
+        }
+
+        if (m_policy.aggregateWarnings) {
+            reportUnhandledElements();
+        }
+        Diagnostics::current().endDocument(); // One write for the whole document's messages
         return true;
     }
 
@@ -61,11 +194,285 @@ namespace SVGParser
         return m_svgElements;
     }
 
+    const std::vector<std::unique_ptr<SVGElements>>& SVGParser::getDefinitions() const {
+        return m_definitions;
+    }
+
+    void SVGParser::setAttributeCacheCapacity(size_t capacity) {
+        m_xmlParser.getAttributeCache().setCapacity(capacity);
+    }
+
+    const AttributeCache& SVGParser::getAttributeCache() const {
+        return m_xmlParser.getAttributeCache();
+    }
+
+    void SVGParser::setParsePolicy(const ParsePolicy& policy) {
+        m_policy = policy;
+    }
+
+    const ParsePolicy& SVGParser::getParsePolicy() const {
+        return m_policy;
+    }
+
+    const SkipStats& SVGParser::getSkipStats() const {
+        return m_skipStats;
+    }
+
+    bool SVGParser::resolveSVGName(const xml_node& xmlNode, std::string& nodeName) const {
+        size_t colon = nodeName.find(':');
+        if (colon == std::string::npos) {
+            // Unprefixed: in the SVG namespace unless this element redeclares the default one
+            xml_attribute xmlns = xmlNode.attribute("xmlns");
+            return !xmlns || std::string(xmlns.value()) == SVGNamespace;
+        }
+
+        // Prefixed: find the nearest declaration of the prefix
+        std::string declaration = "xmlns:" + nodeName.substr(0, colon);
+        for (xml_node node = xmlNode; node; node = node.parent()) {
+            xml_attribute xmlns = node.attribute(declaration.c_str());
+            if (xmlns) {
+                if (std::string(xmlns.value()) != SVGNamespace) {
+                    return false;
+                }
+                nodeName = nodeName.substr(colon + 1);
+                return true;
+            }
+        }
+        return false; // Undeclared prefix
+    }
+
+    void SVGParser::reportUnhandledElements() const {
+        if (m_skipStats.unhandledElements.empty()) {
+            return;
+        }
+
+        std::ostringstream summary;
+        for (const auto& entry : m_skipStats.unhandledElements) {
+            summary << ' ' << entry.first << " (" << entry.second << ")";
+        }
+        SVG_WARN("SVGParser: Unhandled SVG elements:" << summary.str());
+    }
+
+    void SVGParser::setEliminateInvisible(bool eliminate) {
+        m_eliminateInvisible = eliminate;
+    }
+
+    const EliminationStats& SVGParser::getEliminationStats() const {
+        return m_eliminationStats;
+    }
+
+    SVGElements* SVGParser::findById(const std::string& id) const {
+        auto it = m_idIndex.find(id);
+        return it != m_idIndex.end() ? it->second : nullptr;
+    }
+
     void SVGParser::clearElements() {
+        m_idIndex.clear();
+        m_pendingReferences.clear();
         m_svgElements.clear(); // std::unique_ptr automatically clears the memory
+        m_definitions.clear();
+        m_gradients.clear();
+    }
+
+    void SVGParser::registerId(const xml_node& xmlNode, SVGElements* svgElement) {
+        xml_attribute idAttr = xmlNode.attribute("id");
+        if (!idAttr || !*idAttr.value()) {
+            return;
+        }
+
+        svgElement->setId(idAttr.value());
+        // Like browsers, the first element in document order keeps a duplicated id
+        if (!m_idIndex.emplace(svgElement->id, svgElement).second) {
+            SVG_WARN("SVGParser: Duplicate id: " << svgElement->id);
+        }
+    }
+
+    void SVGParser::registerPaintReference(const xml_node& xmlNode, const char* attrName, SVGElements* owner, SVGElements** slot) {
+        xml_attribute attr = xmlNode.attribute(attrName);
+        if (!attr) {
+            return;
+        }
+
+        std::string id = parseUrlReference(attr.value());
+        if (!id.empty()) {
+            m_pendingReferences.push_back({ owner, slot, id });
+        }
+    }
+
+    void SVGParser::registerHrefReference(const xml_node& xmlNode, SVGElements* owner, SVGElements** slot) {
+        xml_attribute attr = xmlNode.attribute("href");
+        if (!attr) {
+            attr = xmlNode.attribute("xlink:href"); // SVG 1.1 documents
+        }
+
+        std::string ref = trim(attr.value());
+        if (ref.size() > 1 && ref[0] == '#') {
+            m_pendingReferences.push_back({ owner, slot, ref.substr(1) });
+        }
+        else {
+            SVG_WARN("SVGParser: <use> without a local href");
+        }
+    }
+
+    void SVGParser::discardRegistration(SVGElements* svgElement, size_t firstReference) {
+        // Definitions among the children registered references too, but they live on in
+        // m_definitions: only what is destroyed with the element may go
+        std::unordered_set<const SVGElements*> dropped;
+        std::vector<SVGElements*> stack{ svgElement };
+        while (!stack.empty()) {
+            SVGElements* element = stack.back();
+            stack.pop_back();
+            dropped.insert(element);
+            auto it = m_idIndex.find(element->id);
+            if (it != m_idIndex.end() && it->second == element) {
+                m_idIndex.erase(it);
+            }
+            if (SVGGroup* group = dynamic_cast<SVGGroup*>(element)) {
+                for (size_t i = 0; i < group->childCount(); ++i) {
+                    stack.push_back(group->child(i));
+                }
+            }
+        }
+
+        auto first = m_pendingReferences.begin() + std::min(firstReference, m_pendingReferences.size());
+        m_pendingReferences.erase(std::remove_if(first, m_pendingReferences.end(), [&](const PendingReference& ref) {
+            return dropped.count(ref.owner) != 0;
+        }), m_pendingReferences.end());
+    }
+
+    bool SVGParser::isHiddenSubtree(const xml_node& xmlNode) const {
+        if (getPresentationValue(xmlNode, "display") == "none") {
+            return true;
+        }
+
+        std::string opacity = getPresentationValue(xmlNode, "opacity");
+        if (!opacity.empty() && parseNumberOrPercentage(opacity, 1.0f) <= 0.0f) {
+            return true;
+        }
+
+        std::string visibility = getPresentationValue(xmlNode, "visibility");
+        if (visibility == "hidden" || visibility == "collapse") {
+            // visibility is inherited, but a descendant can make itself visible again
+            xml_node visibleDescendant = xmlNode.find_node([](const xml_node& node) {
+                return getPresentationValue(node, "visibility") == "visible";
+            });
+            return !visibleDescendant;
+        }
+        return false;
+    }
+
+    bool SVGParser::hasVisiblePaint(const xml_node& xmlNode, bool fillable) const {
+        if (fillable) {
+            if (!parseUrlReference(xmlNode.attribute("fill").value()).empty()) {
+                return true; // Paint server, resolved later
+            }
+            unsigned long fill = m_xmlParser.getAttributeColor(xmlNode, "fill", 0x000000FF);
+            if ((fill & 0xFF) != 0 && m_xmlParser.getAttributeFloat(xmlNode, "fill-opacity", 1.0f) > 0.0f) {
+                return true;
+            }
+        }
+
+        if (m_xmlParser.getAttributeFloat(xmlNode, "stroke-opacity", 1.0f) <= 0.0f) {
+            return false;
+        }
+        // An explicit zero width disables the stroke; a missing one does not
+        xml_attribute width = xmlNode.attribute("stroke-width");
+        if (width && m_xmlParser.getAttributeFloat(xmlNode, "stroke-width", 0.0f) <= 0.0f) {
+            return false;
+        }
+        if (!parseUrlReference(xmlNode.attribute("stroke").value()).empty()) {
+            return true;
+        }
+        return (m_xmlParser.getAttributeColor(xmlNode, "stroke", 0x00000000) & 0xFF) != 0;
+    }
+
+    bool SVGParser::eliminateShape(const xml_node& xmlNode, bool degenerate, bool fillable) {
+        if (!m_eliminateInvisible || m_definitionDepth > 0) {
+            return false;
+        }
+        if (degenerate) {
+            ++m_eliminationStats.degenerateShapes;
+            return true;
+        }
+        if (!hasVisiblePaint(xmlNode, fillable)) {
+            ++m_eliminationStats.invisiblePaint;
+            return true;
+        }
+        return false;
+    }
+
+    void SVGParser::resolveReferences() {
+        for (const PendingReference& ref : m_pendingReferences) {
+            SVGElements* target = findById(ref.id);
+            if (!target) {
+                SVG_WARN("SVGParser: Unresolved reference: #" << ref.id);
+            }
+            *ref.slot = target;
+        }
+        m_pendingReferences.clear();
+        breakUseCycles();
+    }
+
+    void SVGParser::breakUseCycles() {
+        // Depth-first walk over group children and <use> targets, with an explicit stack so
+        // that deep documents cannot overflow the call stack. A target that is still being
+        // visited is an ancestor of the <use>: following it would never end.
+        enum class Visit { Active, Done };
+        std::unordered_map<const SVGElements*, Visit> state;
+        struct Frame {
+            SVGElements* element;
+            size_t next; // Child (or target) to visit next
+        };
+        std::vector<Frame> stack;
+
+        for (const auto* roots : { &m_svgElements, &m_definitions }) {
+            for (const std::unique_ptr<SVGElements>& root : *roots) {
+                if (!state.emplace(root.get(), Visit::Active).second) {
+                    continue;
+                }
+                stack.push_back({ root.get(), 0 });
+                while (!stack.empty()) {
+                    Frame& frame = stack.back();
+                    SVGElements* next = nullptr;
+                    if (SVGGroup* group = dynamic_cast<SVGGroup*>(frame.element)) {
+                        if (frame.next < group->childCount()) {
+                            next = group->child(frame.next++);
+                        }
+                    }
+                    else if (SVGUse* use = dynamic_cast<SVGUse*>(frame.element)) {
+                        if (frame.next++ == 0 && use->target) {
+                            auto it = state.find(use->target);
+                            if (it != state.end() && it->second == Visit::Active) {
+                                SVG_WARN("SVGParser: <use> reference cycle through "
+                                    << (use->target->id.empty() ? std::string("an unnamed element") : "#" + use->target->id)
+                                    << "; the instance is not drawn");
+                                use->target = nullptr;
+                            }
+                            else {
+                                next = use->target;
+                            }
+                        }
+                    }
+
+                    if (!next) {
+                        state[frame.element] = Visit::Done;
+                        stack.pop_back();
+                    }
+                    else if (state.emplace(next, Visit::Active).second) {
+                        stack.push_back({ next, 0 });
+                    }
+                }
+            }
+        }
     }
 
     void SVGParser::parseCommonAttributes(const xml_node& xmlNode, SVGElements* svgElement) {
+        registerId(xmlNode, svgElement);
+
+        // Paint servers referenced as url(#id), resolved after the whole document is parsed
+        registerPaintReference(xmlNode, "fill", svgElement, &svgElement->fillRef);
+        registerPaintReference(xmlNode, "stroke", svgElement, &svgElement->strokeRef);
+
         // Colour & opacity
         svgElement->setDefaultFillColour(m_xmlParser.getAttributeColor(xmlNode, "fill", 0x000000FF)); // Default black
         svgElement->setDefaultStrokeColour(m_xmlParser.getAttributeColor(xmlNode, "stroke", 0x00000000)); // Default transparent (no stroke)
@@ -77,6 +484,10 @@ namespace SVGParser
 
         // Width of stroke
         svgElement->setDefaultStrokeWidth(m_xmlParser.getAttributeFloat(xmlNode, "stroke-width", 0.0f));
+        svgElement->strokeStyle = parseStrokeStyle(xmlNode);
+        if (getPresentationValue(xmlNode, "fill-rule") == "evenodd") {
+            svgElement->fillRule = FillRule::EvenOdd;
+        }
     }
 
     std::vector<Point2D> SVGParser::parsePointsString(const std::string& pointsString) {
@@ -95,7 +506,7 @@ namespace SVGParser
                 points.push_back(Point2D(x, y));
             }
             else {
-                std::cerr << "SVGParser: Warning - Invalid point format in points string: " << segment << std::endl;
+                SVG_WARN("SVGParser: Invalid point format in points string: " << segment);
             }
         }
         return points;
@@ -106,6 +517,9 @@ namespace SVGParser
         float y = m_xmlParser.getAttributeFloat(xmlNode, "y", 0.0f);
         float width = m_xmlParser.getAttributeFloat(xmlNode, "width", 0.0f);
         float height = m_xmlParser.getAttributeFloat(xmlNode, "height", 0.0f); // elements.h dùng 'length'
+        if (eliminateShape(xmlNode, width <= 0.0f || height <= 0.0f, true)) {
+            return nullptr;
+        }
 
         auto rect = std::make_unique<SVGRectangle>(Point2D(x, y), height, width);
         parseCommonAttributes(xmlNode, rect.get());
@@ -116,6 +530,9 @@ namespace SVGParser
         float cx = m_xmlParser.getAttributeFloat(xmlNode, "cx", 0.0f);
         float cy = m_xmlParser.getAttributeFloat(xmlNode, "cy", 0.0f);
         float r = m_xmlParser.getAttributeFloat(xmlNode, "r", 0.0f);
+        if (eliminateShape(xmlNode, r <= 0.0f, true)) {
+            return nullptr;
+        }
 
         auto circle = std::make_unique<SVGCircle>(Point2D(cx, cy), r);
         parseCommonAttributes(xmlNode, circle.get());
@@ -127,6 +544,9 @@ namespace SVGParser
         float cy = m_xmlParser.getAttributeFloat(xmlNode, "cy", 0.0f);
         float rx = m_xmlParser.getAttributeFloat(xmlNode, "rx", 0.0f);
         float ry = m_xmlParser.getAttributeFloat(xmlNode, "ry", 0.0f);
+        if (eliminateShape(xmlNode, rx <= 0.0f || ry <= 0.0f, true)) {
+            return nullptr;
+        }
 
         auto ellipse = std::make_unique<SVGEllipse>(Point2D(cx, cy), rx, ry);
         parseCommonAttributes(xmlNode, ellipse.get());
@@ -138,6 +558,10 @@ namespace SVGParser
         float y1 = m_xmlParser.getAttributeFloat(xmlNode, "y1", 0.0f);
         float x2 = m_xmlParser.getAttributeFloat(xmlNode, "x2", 0.0f);
         float y2 = m_xmlParser.getAttributeFloat(xmlNode, "y2", 0.0f);
+        // A line has no area: only its stroke can show
+        if (eliminateShape(xmlNode, x1 == x2 && y1 == y2, false)) {
+            return nullptr;
+        }
 
         auto line = std::make_unique<SVGLine>(Point2D(x1, y1), Point2D(x2, y2));
         parseCommonAttributes(xmlNode, line.get());
@@ -147,6 +571,9 @@ namespace SVGParser
     std::unique_ptr<SVGElements> SVGParser::parsePolylineAttributes(const xml_node& xmlNode) {
         std::string pointsStr = m_xmlParser.getAttributeString(xmlNode, "points");
         std::vector<Point2D> points = parsePointsString(pointsStr);
+        if (eliminateShape(xmlNode, points.size() < 2, true)) {
+            return nullptr;
+        }
 
         auto polyline = std::make_unique<SVGPolyline>(points);
         parseCommonAttributes(xmlNode, polyline.get());
@@ -156,6 +583,9 @@ namespace SVGParser
     std::unique_ptr<SVGElements> SVGParser::parsePolygonAttributes(const xml_node& xmlNode) {
         std::string pointsStr = m_xmlParser.getAttributeString(xmlNode, "points");
         std::vector<Point2D> points = parsePointsString(pointsStr);
+        if (eliminateShape(xmlNode, points.size() < 2, true)) {
+            return nullptr;
+        }
 
         auto polygon = std::make_unique<SVGPolygon>(points);
         parseCommonAttributes(xmlNode, polygon.get());
@@ -169,6 +599,9 @@ namespace SVGParser
         int fontSize = static_cast<int>(m_xmlParser.getAttributeFloat(xmlNode, "font-size", 16.0f)); // Default font size
         std::string typeface = m_xmlParser.getAttributeString(xmlNode, "font-family", "Arial"); // Default font family
         std::string fontPath = "../Dense.ttf";  // Path to font family
+        if (eliminateShape(xmlNode, trim(textContent).empty() || fontSize <= 0, true)) {
+            return nullptr;
+        }
 
         auto text = std::make_unique<SVGText>(Point2D(x, y), textContent, fontSize, typeface, fontPath);
         parseCommonAttributes(xmlNode, text.get());
@@ -178,10 +611,12 @@ namespace SVGParser
     std::unique_ptr<SVGElements> SVGParser::parseGroupAttributes(const xml_node& xmlNode)
     {
         auto group = std::make_unique<SVGGroup>();
+        const size_t firstReference = m_pendingReferences.size();
 
         // Parse common styles and transform (only those allowed)
         parseCommonAttributes(xmlNode, group.get());
-        group->setTransform(m_xmlParser.getAttributeString(xmlNode, "transform", ""));
+        group->setTransform(m_xmlParser.getAttributeString(xmlNode, "transform", ""),
+            m_xmlParser.getAttributeTransform(xmlNode, "transform"));
 
         // Parse children recursively
         for (auto child : xmlNode.children()) {
@@ -189,18 +624,176 @@ namespace SVGParser
             if (childElem)
                 group->addChild(std::move(childElem));
         }
+
+        // Nothing left to draw (every child was eliminated, or there were none)
+        if (m_eliminateInvisible && m_definitionDepth == 0 && group->childCount() == 0) {
+            ++m_eliminationStats.emptyGroups;
+            discardRegistration(group.get(), firstReference);
+            return nullptr;
+        }
         return group;
     }
 
     std::unique_ptr<SVGElements> SVGParser::parsePathAttributes(const xml_node& xmlNode) {
         std::string dStr = m_xmlParser.getAttributeString(xmlNode, "d");
+        if (eliminateShape(xmlNode, dStr.find_first_not_of(" \t\n\r") == std::string::npos, true)) {
+            return nullptr;
+        }
         auto path = std::make_unique<SVGPath>(dStr);
         parseCommonAttributes(xmlNode, path.get());
         return path;
     }
 
+    std::unique_ptr<SVGElements> SVGParser::parseUseAttributes(const xml_node& xmlNode) {
+        float x = m_xmlParser.getAttributeFloat(xmlNode, "x", 0.0f);
+        float y = m_xmlParser.getAttributeFloat(xmlNode, "y", 0.0f);
+
+        auto use = std::make_unique<SVGUse>(Point2D(x, y));
+        parseCommonAttributes(xmlNode, use.get());
+        registerHrefReference(xmlNode, use.get(), &use->target);
+
+        // x/y act as an additional translation after the element's own transform
+        std::string transformStr = m_xmlParser.getAttributeString(xmlNode, "transform", "");
+        Transform transform = m_xmlParser.getAttributeTransform(xmlNode, "transform");
+        if (x != 0.0f || y != 0.0f) {
+            std::ostringstream oss;
+            oss << transformStr << (transformStr.empty() ? "" : " ") << "translate(" << x << "," << y << ")";
+            transformStr = oss.str();
+            transform = transform * Transform::translate(x, y);
+        }
+        use->setTransform(transformStr, transform);
+        return use;
+    }
+
+    std::unique_ptr<SVGElements> SVGParser::parseGradientAttributes(const xml_node& xmlNode, bool radial) {
+        std::unique_ptr<SVGGradient> gradient;
+        if (radial) {
+            auto radialGradient = std::make_unique<SVGRadialGradient>();
+            radialGradient->centre.x = parseNumberOrPercentage(xmlNode.attribute("cx").value(), 0.5f);
+            radialGradient->centre.y = parseNumberOrPercentage(xmlNode.attribute("cy").value(), 0.5f);
+            radialGradient->radius = parseNumberOrPercentage(xmlNode.attribute("r").value(), 0.5f);
+            // The focal point defaults to the centre
+            radialGradient->focal.x = parseNumberOrPercentage(xmlNode.attribute("fx").value(), radialGradient->centre.x);
+            radialGradient->focal.y = parseNumberOrPercentage(xmlNode.attribute("fy").value(), radialGradient->centre.y);
+            gradient = std::move(radialGradient);
+        }
+        else {
+            auto linearGradient = std::make_unique<SVGLinearGradient>();
+            linearGradient->p1.x = parseNumberOrPercentage(xmlNode.attribute("x1").value(), 0.0f);
+            linearGradient->p1.y = parseNumberOrPercentage(xmlNode.attribute("y1").value(), 0.0f);
+            linearGradient->p2.x = parseNumberOrPercentage(xmlNode.attribute("x2").value(), 1.0f);
+            linearGradient->p2.y = parseNumberOrPercentage(xmlNode.attribute("y2").value(), 0.0f);
+            gradient = std::move(linearGradient);
+        }
+
+        registerId(xmlNode, gradient.get());
+        if (xmlNode.attribute("href") || xmlNode.attribute("xlink:href")) {
+            registerHrefReference(xmlNode, gradient.get(), &gradient->hrefRef);
+        }
+
+        std::string units = m_xmlParser.getAttributeString(xmlNode, "gradientUnits", "objectBoundingBox");
+        gradient->units = (units == "userSpaceOnUse") ? GradientUnits::UserSpaceOnUse : GradientUnits::ObjectBoundingBox;
+
+        std::string spread = m_xmlParser.getAttributeString(xmlNode, "spreadMethod", "pad");
+        gradient->spread = (spread == "reflect") ? SpreadMethod::Reflect
+            : (spread == "repeat") ? SpreadMethod::Repeat : SpreadMethod::Pad;
+
+        gradient->gradientTransformStr = m_xmlParser.getAttributeString(xmlNode, "gradientTransform", "");
+        gradient->gradientTransform = m_xmlParser.getAttributeTransform(xmlNode, "gradientTransform");
+
+        parseGradientStops(xmlNode, gradient.get());
+        m_gradients.push_back(gradient.get());
+        return gradient;
+    }
+
+    void SVGParser::parseGradientStops(const xml_node& xmlNode, SVGGradient* gradient) {
+        float previousOffset = 0.0f;
+        for (xml_node stop : xmlNode.children("stop")) {
+            // Offsets are clamped to [0, 1] and may never go backwards
+            float offset = parseNumberOrPercentage(stop.attribute("offset").value(), 0.0f);
+            offset = std::max(previousOffset, std::min(offset, 1.0f));
+            previousOffset = offset;
+
+            std::string colour = getPresentationValue(stop, "stop-color");
+            unsigned long rgba = colour.empty() ? 0x000000FF : parseColorString(colour, 0x000000FF);
+
+            std::string opacityStr = getPresentationValue(stop, "stop-opacity");
+            float opacity = parseNumberOrPercentage(opacityStr, 1.0f);
+            opacity = std::max(0.0f, std::min(opacity, 1.0f));
+            unsigned long alpha = static_cast<unsigned long>((rgba & 0xFF) * opacity + 0.5f);
+
+            gradient->stops.push_back({ offset, (rgba & 0xFFFFFF00) | alpha });
+        }
+    }
+
+    void SVGParser::parseDefinitions(const xml_node& xmlNode) {
+        ++m_definitionDepth;
+        for (auto child : xmlNode.children()) {
+            auto definition = parseSVGElement(child);
+            if (definition)
+                m_definitions.push_back(std::move(definition));
+        }
+        --m_definitionDepth;
+    }
+
+    void SVGParser::parseHiddenDefinitions(const xml_node& xmlNode) {
+        for (xml_node child : xmlNode.children()) {
+            if (child.type() != pugi::node_element) {
+                continue;
+            }
+            std::string nodeName = child.name();
+            if (!resolveSVGName(child, nodeName) && m_policy.skipForeignNamespaces) {
+                continue;
+            }
+            if (nodeName == "defs" || nodeName == "linearGradient" || nodeName == "radialGradient" || nodeName == "symbol") {
+                parseSVGElement(child); // Stored among the definitions
+            }
+            else if (!(m_policy.skipNonRendering && isNonRenderingElement(nodeName))) {
+                parseHiddenDefinitions(child);
+            }
+        }
+    }
+
     std::unique_ptr<SVGElements> SVGParser::parseSVGElement(const xml_node& xmlNode) {
+        if (xmlNode.type() != pugi::node_element) {
+            return nullptr;
+        }
+
+        // Editor metadata and other non-rendering subtrees are skipped in one step
         std::string nodeName = xmlNode.name();
+        if (!resolveSVGName(xmlNode, nodeName) && m_policy.skipForeignNamespaces) {
+            ++m_skipStats.foreignSubtrees;
+            return nullptr;
+        }
+        if (m_policy.skipNonRendering && isNonRenderingElement(nodeName)) {
+            ++m_skipStats.nonRenderingSubtrees;
+            return nullptr;
+        }
+
+        // Definitions are only drawn through references, so they are never eliminated
+        if (nodeName == "defs") {
+            parseDefinitions(xmlNode);
+            return nullptr;
+        }
+        else if (nodeName == "linearGradient" || nodeName == "radialGradient") {
+            // Paint servers are definitions wherever they appear
+            m_definitions.push_back(parseGradientAttributes(xmlNode, nodeName == "radialGradient"));
+            return nullptr;
+        }
+        else if (nodeName == "symbol") {
+            // A symbol is a group that only renders through <use>
+            ++m_definitionDepth;
+            m_definitions.push_back(parseGroupAttributes(xmlNode));
+            --m_definitionDepth;
+            return nullptr;
+        }
+
+        // A hidden subtree is skipped in one step, without building any of its shapes
+        if (m_eliminateInvisible && m_definitionDepth == 0 && isHiddenSubtree(xmlNode)) {
+            ++m_eliminationStats.hiddenSubtrees;
+            parseHiddenDefinitions(xmlNode);
+            return nullptr;
+        }
 
         if (nodeName == "rect") {
             return parseRectangleAttributes(xmlNode);
@@ -226,8 +819,17 @@ namespace SVGParser
         else if (nodeName == "g") {
             return parseGroupAttributes(xmlNode);
         }
+        else if (nodeName == "path") {
+            return parsePathAttributes(xmlNode);
+        }
+        else if (nodeName == "use") {
+            return parseUseAttributes(xmlNode);
+        }
 
-        std::cerr << "SVGParser: Warning - Unhandled SVG element: " << nodeName << std::endl;
+        ++m_skipStats.unhandledElements[nodeName];
+        if (!m_policy.aggregateWarnings) {
+            SVG_WARN("SVGParser: Unhandled SVG element: " << nodeName);
+        }
         return nullptr;
     }
 } // namespace SVGParser
\ No newline at end of file
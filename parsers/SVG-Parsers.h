@@ -4,21 +4,110 @@
 #include <vector>
 #include <string>
 #include <memory> // For std::unique_ptr
+#include <unordered_map>
+#include <map>
 
 #include "XML-ParsersWrapper.h"      // Bao gồm XMLParserWrapper
 #include "../src/elements/elements.h"    // Bao gồm elements.h của bạn
+#include "../src/elements/Gradient.h"
 #include "../renderer/IRenderer.h"       // Bao gồm IRenderer.h
 
 namespace SVGParser
 {
+    // What the elimination pass removed during the last parse
+    struct EliminationStats {
+        size_t hiddenSubtrees = 0;   // display="none", visibility="hidden" or opacity="0", skipped unbuilt
+        size_t degenerateShapes = 0; // Zero-area rects, zero-radius circles/ellipses, empty geometry
+        size_t invisiblePaint = 0;   // Neither fill nor stroke can produce a pixel
+        size_t emptyGroups = 0;      // Groups with nothing left to draw
+
+        size_t total() const { return hiddenSubtrees + degenerateShapes + invisiblePaint + emptyGroups; }
+    };
+
+    // What the parser walks into. Editor files (Inkscape, Illustrator, Sodipodi) carry large
+    // subtrees that never render; skipping them whole avoids visiting every node.
+    struct ParsePolicy {
+        bool skipForeignNamespaces = true; // sodipodi:*, inkscape:*, rdf:*, xhtml... anything outside the SVG namespace
+        bool skipNonRendering = true;      // <metadata>, <title>, <desc>, <style>, <script>, <clipPath>, ...
+        bool aggregateWarnings = true;     // One summary of unknown tags per document instead of a line each
+    };
+
+    // What the parse policy skipped during the last parse
+    struct SkipStats {
+        size_t foreignSubtrees = 0;
+        size_t nonRenderingSubtrees = 0;
+        std::map<std::string, size_t> unhandledElements; // Tag name -> occurrences
+    };
+
     class SVGParser {
     private:
         XMLParserWrapper m_xmlParser;
         std::vector<std::unique_ptr<SVGElements>> m_svgElements;
 
+        // Content of <defs> and <symbol>: never rendered directly, only through <use>
+        std::vector<std::unique_ptr<SVGElements>> m_definitions;
+
+        // Gradients among the definitions, finalised (stops inherited, ramp built) after parsing
+        std::vector<SVGGradient*> m_gradients;
+
+        // Per-document index of id attributes, filled while parsing
+        std::unordered_map<std::string, SVGElements*> m_idIndex;
+
+        // A url(#id) reference waiting to be resolved into 'slot' once the whole document is parsed
+        struct PendingReference {
+            SVGElements* owner;
+            SVGElements** slot;
+            std::string id;
+        };
+        std::vector<PendingReference> m_pendingReferences;
+
+        // Records the id of an element in the index
+        void registerId(const pugi::xml_node& xmlNode, SVGElements* svgElement);
+
+        // Queues a paint attribute of the form url(#id) for resolution
+        void registerPaintReference(const pugi::xml_node& xmlNode, const char* attrName, SVGElements* owner, SVGElements** slot);
+
+        // Queues the href (or xlink:href) of a <use> for resolution
+        void registerHrefReference(const pugi::xml_node& xmlNode, SVGElements* owner, SVGElements** slot);
+
+        // Undoes registerId/register*Reference for an element that is dropped after all, and
+        // for its descendants. 'firstReference' is the size of m_pendingReferences before the
+        // element registered anything: only entries from there on can belong to it.
+        void discardRegistration(SVGElements* svgElement, size_t firstReference);
+
+        // Turns every pending reference into a direct pointer
+        void resolveReferences();
+
+        // Clears the target of each <use> that would instance one of its own ancestors, so
+        // that rendering needs no cycle guard (the SVG spec makes such a reference an error)
+        void breakUseCycles();
+
         // Helper to analyse common attributes of elements
         void parseCommonAttributes(const pugi::xml_node& xmlNode, SVGElements* svgElement);
 
+        ParsePolicy m_policy;
+        SkipStats m_skipStats;
+
+        // False for elements outside the SVG namespace; strips an SVG prefix ("svg:rect" -> "rect")
+        bool resolveSVGName(const pugi::xml_node& xmlNode, std::string& nodeName) const;
+
+        // Reports the unknown tags of the document (once, when warnings are aggregated)
+        void reportUnhandledElements() const;
+
+        // Parse-time elimination of elements that cannot contribute pixels
+        bool m_eliminateInvisible = true;
+        int m_definitionDepth = 0; // > 0 inside <defs>/<symbol>, whose content is only drawn through <use>
+        EliminationStats m_eliminationStats;
+
+        // display="none", opacity="0", or visibility="hidden" with no visible descendant
+        bool isHiddenSubtree(const pugi::xml_node& xmlNode) const;
+
+        // True if fill (when the shape has an area) or stroke can produce a pixel
+        bool hasVisiblePaint(const pugi::xml_node& xmlNode, bool fillable) const;
+
+        // Elimination check of a leaf shape before it is built; counts what it drops
+        bool eliminateShape(const pugi::xml_node& xmlNode, bool degenerate, bool fillable);
+
         // Helper to analyse a string to a vector of Point2Ds
         std::vector<Point2D> parsePointsString(const std::string& pointsString);
 
@@ -32,6 +121,18 @@ namespace SVGParser
         std::unique_ptr<SVGElements> parseTextAttributes(const pugi::xml_node& xmlNode);
         std::unique_ptr<SVGElements> parseGroupAttributes(const pugi::xml_node& xmlNode);
         std::unique_ptr<SVGElements> parsePathAttributes(const pugi::xml_node& xmlNode);
+        std::unique_ptr<SVGElements> parseUseAttributes(const pugi::xml_node& xmlNode);
+        std::unique_ptr<SVGElements> parseGradientAttributes(const pugi::xml_node& xmlNode, bool radial);
+
+        // Helper to read the <stop> children of a gradient
+        void parseGradientStops(const pugi::xml_node& xmlNode, SVGGradient* gradient);
+
+        // Stores the children of <defs> (or a <symbol>) as shared definitions
+        void parseDefinitions(const pugi::xml_node& xmlNode);
+
+        // Keeps the <defs>, gradients and <symbol>s inside a hidden subtree, whose renderable
+        // content is dropped: 'display' and the like do not apply to what is only referenced
+        void parseHiddenDefinitions(const pugi::xml_node& xmlNode);
 
 
         // To sort dispatches of elements
@@ -47,6 +148,32 @@ namespace SVGParser
         // Take analysed vectors of SVGElements
         const std::vector<std::unique_ptr<SVGElements>>& getSVGElements() const;
 
+        // Take the definitions (<defs> content and <symbol>s) that <use> elements refer to
+        const std::vector<std::unique_ptr<SVGElements>>& getDefinitions() const;
+
+        // Look up an element by its id attribute, nullptr if no element has it
+        SVGElements* findById(const std::string& id) const;
+
+        // Maximum number of memoised values per kind (colours, numbers, transforms); 0 disables it
+        void setAttributeCacheCapacity(size_t capacity);
+
+        // Memo hit/miss statistics of the last parse
+        const AttributeCache& getAttributeCache() const;
+
+        // Which subtrees are skipped and how unknown tags are reported
+        void setParsePolicy(const ParsePolicy& policy);
+        const ParsePolicy& getParsePolicy() const;
+
+        // What the policy skipped during the last parse
+        const SkipStats& getSkipStats() const;
+
+        // Enable/disable dropping invisible and degenerate elements at parse time (enabled by default).
+        // Disable it when elements are looked up by id to be modified after parsing.
+        void setEliminateInvisible(bool eliminate);
+
+        // What the elimination pass removed during the last parse
+        const EliminationStats& getEliminationStats() const;
+
         // Delete parsed elements
         void clearElements();
     };
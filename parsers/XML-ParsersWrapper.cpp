@@ -1,7 +1,15 @@
 ﻿#include "XML-ParsersWrapper.h"
 #include "ColorUtils.h"
+#include "Diagnostics.h"
 #include <iostream>
 #include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#ifdef SVGREADER_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 namespace SVGParser
 {
@@ -9,19 +17,121 @@ namespace SVGParser
 
     XMLParserWrapper::~XMLParserWrapper() {}
 
+    // Helper to recognise gzip data by its magic bytes
+    bool isGzipFile(const std::string& filePath) {
+        unsigned char magic[2] = { 0, 0 };
+        FILE* file = std::fopen(filePath.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        size_t read = std::fread(magic, 1, 2, file);
+        std::fclose(file);
+        return read == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+    }
+
     bool XMLParserWrapper::loadFile(const std::string& filePath) {
+        if (isGzipFile(filePath)) {
+            return loadGzipFile(filePath);
+        }
+
         pugi::xml_parse_result result = m_doc.load_file(filePath.c_str());
         if (!result) {
-            std::cerr << "XMLParserWrapper: Failed to load XML file: " << filePath << ". Error: " << result.description() << std::endl;
+            SVG_ERROR("XMLParserWrapper: Failed to load XML file: " << filePath << ". Error: " << result.description());
             return false;
         }
         return true;
     }
 
+#ifdef SVGREADER_HAVE_ZLIB
+    // Helper to read the uncompressed size from the gzip trailer (a hint: it is stored modulo 2^32)
+    size_t gzipSizeHint(const std::string& filePath) {
+        FILE* file = std::fopen(filePath.c_str(), "rb");
+        if (!file) {
+            return 0;
+        }
+        unsigned char trailer[4] = { 0, 0, 0, 0 };
+        long compressed = 0;
+        if (std::fseek(file, 0, SEEK_END) == 0 && (compressed = std::ftell(file)) >= 4
+            && std::fseek(file, -4, SEEK_END) == 0) {
+            if (std::fread(trailer, 1, 4, file) != 4) {
+                compressed = 0;
+            }
+        }
+        std::fclose(file);
+
+        size_t size = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<size_t>(trailer[3]) << 24);
+        // Deflate cannot expand more than ~1032:1; anything above is a corrupt or multi-member trailer
+        return std::min(size, static_cast<size_t>(compressed) * 1032);
+    }
+
+    bool XMLParserWrapper::loadGzipFile(const std::string& filePath) {
+        gzFile file = gzopen(filePath.c_str(), "rb");
+        if (!file) {
+            SVG_ERROR("XMLParserWrapper: Failed to open compressed file: " << filePath);
+            return false;
+        }
+        gzbuffer(file, 128 * 1024);
+
+        // Sized from the trailer, the buffer normally never grows; pugixml takes ownership of it
+        pugi::allocation_function allocate = pugi::get_memory_allocation_function();
+        pugi::deallocation_function deallocate = pugi::get_memory_deallocation_function();
+        size_t capacity = std::max<size_t>(gzipSizeHint(filePath), 4096) + 1;
+        char* buffer = static_cast<char*>(allocate(capacity));
+        size_t size = 0;
+        bool ok = buffer != nullptr;
+
+        while (ok) {
+            if (size == capacity) {
+                char* grown = static_cast<char*>(allocate(capacity * 2));
+                if (!grown) {
+                    ok = false;
+                    break;
+                }
+                std::memcpy(grown, buffer, size);
+                deallocate(buffer);
+                buffer = grown;
+                capacity *= 2;
+            }
+
+            unsigned chunk = static_cast<unsigned>(std::min<size_t>(capacity - size, INT_MAX));
+            int read = gzread(file, buffer + size, chunk);
+            if (read < 0) {
+                int code = 0;
+                SVG_ERROR("XMLParserWrapper: Failed to decompress " << filePath << ": " << gzerror(file, &code));
+                ok = false;
+            }
+            else if (read == 0) {
+                break;
+            }
+            size += static_cast<size_t>(read);
+        }
+        gzclose(file);
+
+        if (!ok) {
+            if (buffer) {
+                deallocate(buffer);
+            }
+            return false;
+        }
+
+        pugi::xml_parse_result result = m_doc.load_buffer_inplace_own(buffer, size);
+        if (!result) {
+            SVG_ERROR("XMLParserWrapper: Failed to load XML file: " << filePath << ". Error: " << result.description());
+            return false;
+        }
+        return true;
+    }
+#else
+    bool XMLParserWrapper::loadGzipFile(const std::string& filePath) {
+        SVG_ERROR("XMLParserWrapper: Cannot read compressed file " << filePath << ": built without zlib");
+        return false;
+    }
+#endif
+
     bool XMLParserWrapper::loadString(const std::string& xmlString) {
         pugi::xml_parse_result result = m_doc.load_string(xmlString.c_str());
         if (!result) {
-            std::cerr << "XMLParserWrapper: Failed to load XML string. Error: " << result.description() << std::endl;
+            SVG_ERROR("XMLParserWrapper: Failed to load XML string. Error: " << result.description());
             return false;
         }
         return true;
@@ -36,7 +146,10 @@ namespace SVGParser
     }
 
     float XMLParserWrapper::getAttributeFloat(const pugi::xml_node& node, const std::string& attrName, float defaultValue) const {
-        return node.attribute(attrName.c_str()).as_float(defaultValue);
+        pugi::xml_attribute attr = node.attribute(attrName.c_str());
+        if (!attr) return defaultValue;
+
+        return m_cache.number(attr.value());
     }
 
     // Directly reads the colour in unsigned long form. Whenever try to read, use "0x" + the RGB-A code in hex form.
@@ -44,8 +157,23 @@ namespace SVGParser
         auto attr = node.attribute(attrName.c_str());
         if (!attr) return defaultValue;
 
-        std::string colorStr = attr.value();
-        return parseColorString(colorStr, defaultValue);
+        return m_cache.colour(attr.value(), defaultValue);
+    }
+
+    const Transform& XMLParserWrapper::getAttributeTransform(const pugi::xml_node& node, const std::string& attrName) const {
+        static const Transform identity;
+        pugi::xml_attribute attr = node.attribute(attrName.c_str());
+        if (!attr) return identity;
+
+        return m_cache.transform(attr.value());
+    }
+
+    AttributeCache& XMLParserWrapper::getAttributeCache() {
+        return m_cache;
+    }
+
+    const AttributeCache& XMLParserWrapper::getAttributeCache() const {
+        return m_cache;
     }
 
     std::vector<pugi::xml_node> XMLParserWrapper::getChildNodes(const pugi::xml_node& node) const {
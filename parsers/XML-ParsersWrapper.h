@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include "pugixml.hpp"
+#include "AttributeCache.h"
 
 namespace SVGParser
 {
@@ -11,11 +12,17 @@ namespace SVGParser
     private:
         pugi::xml_document m_doc;
 
+        // Memo of parsed colour/number/transform attribute values for the current document
+        mutable AttributeCache m_cache;
+
+        // Decompresses a gzip file straight into a buffer handed to pugixml
+        bool loadGzipFile(const std::string& filePath);
+
     public:
         XMLParserWrapper();
         ~XMLParserWrapper();
        
-        // Load XML document from file
+        // Load XML document from file; gzip-compressed files (.svgz) are decompressed on the fly
         bool loadFile(const std::string& filePath);
 
         // Load XML document from strings in the memory
@@ -33,6 +40,13 @@ namespace SVGParser
         // Colour value properties unsigned long RGBA
         unsigned long getAttributeColor(const pugi::xml_node& node, const std::string& attrName, unsigned long defaultValue = 0x000000FF) const;
 
+        // Transform properties, parsed through the memo (identity when absent)
+        const Transform& getAttributeTransform(const pugi::xml_node& node, const std::string& attrName) const;
+
+        // Memo table used by the getAttribute* helpers
+        AttributeCache& getAttributeCache();
+        const AttributeCache& getAttributeCache() const;
+
         // Children of nodes in XML
         std::vector<pugi::xml_node> getChildNodes(const pugi::xml_node& node) const;
     };
@@ -0,0 +1,191 @@
+﻿// src/Compositing.cpp
+#include "Compositing.h"
+#include "CompositingKernels.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SVGREADER_X86_CPUID 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define SVGREADER_X86_CPUID 1
+#endif
+
+uint32_t premultiplyColour(unsigned long colour)
+{
+    uint32_t r = (colour >> 24) & 0xFF, g = (colour >> 16) & 0xFF, b = (colour >> 8) & 0xFF, a = colour & 0xFF;
+    return mul255(r, a) | (mul255(g, a) << 8) | (mul255(b, a) << 16) | (a << 24);
+}
+
+void unpremultiplySpan(const uint32_t* src, int count, uint8_t* out)
+{
+    for (int x = 0; x < count; ++x) {
+        uint32_t p = src[x], a = p >> 24;
+        for (int c = 0; c < 3; ++c) {
+            uint32_t v = (p >> (8 * c)) & 0xFF;
+            *out++ = static_cast<uint8_t>(a ? std::min<uint32_t>(255, (v * 255 + a / 2) / a) : 0);
+        }
+        *out++ = static_cast<uint8_t>(a);
+    }
+}
+
+void premultiplySpan(const uint8_t* src, int count, uint32_t* out)
+{
+    for (int x = 0; x < count; ++x, src += 4) {
+        uint32_t a = src[3];
+        out[x] = mul255(src[0], a) | (mul255(src[1], a) << 8) | (mul255(src[2], a) << 16) | (a << 24);
+    }
+}
+
+namespace
+{
+    // One pixel of source-over: src scaled by coverage, dst by the remaining transparency
+    inline uint32_t blendPixel(uint32_t dst, uint32_t src, uint32_t cover)
+    {
+        if (cover != 255) {
+            src = mul255(src & 0xFF, cover) | (mul255((src >> 8) & 0xFF, cover) << 8)
+                | (mul255((src >> 16) & 0xFF, cover) << 16) | (mul255(src >> 24, cover) << 24);
+        }
+        uint32_t inverse = 255 - (src >> 24);
+        return (mul255(dst & 0xFF, inverse) + (src & 0xFF))
+            | ((mul255((dst >> 8) & 0xFF, inverse) + ((src >> 8) & 0xFF)) << 8)
+            | ((mul255((dst >> 16) & 0xFF, inverse) + ((src >> 16) & 0xFF)) << 16)
+            | ((mul255(dst >> 24, inverse) + (src >> 24)) << 24);
+    }
+
+    const CompositeKernels scalarKernels = { compositeSolidSpanScalar, compositeSpanScalar };
+
+    const CompositeKernels* kernelsFor(SimdLevel level)
+    {
+        switch (level) {
+        case SimdLevel::SSE2:   return sse2CompositeKernels();
+        case SimdLevel::AVX2:   return avx2CompositeKernels();
+        case SimdLevel::AVX512: return avx512CompositeKernels();
+        default:                return &scalarKernels;
+        }
+    }
+
+    bool cpuSupports(SimdLevel level)
+    {
+        if (level == SimdLevel::Scalar)
+            return true;
+#ifdef SVGREADER_X86_CPUID
+        unsigned regs1[4] = { 0, 0, 0, 0 }, regs7[4] = { 0, 0, 0, 0 };
+        unsigned maxLeaf;
+#ifdef _MSC_VER
+        int r[4];
+        __cpuid(r, 0);
+        maxLeaf = static_cast<unsigned>(r[0]);
+        __cpuid(r, 1);
+        for (int i = 0; i < 4; ++i) regs1[i] = static_cast<unsigned>(r[i]);
+        if (maxLeaf >= 7) {
+            __cpuidex(r, 7, 0);
+            for (int i = 0; i < 4; ++i) regs7[i] = static_cast<unsigned>(r[i]);
+        }
+#else
+        maxLeaf = __get_cpuid_max(0, nullptr);
+        __cpuid(1, regs1[0], regs1[1], regs1[2], regs1[3]);
+        if (maxLeaf >= 7)
+            __cpuid_count(7, 0, regs7[0], regs7[1], regs7[2], regs7[3]);
+#endif
+        const bool sse2 = (regs1[3] >> 26) & 1;
+        if (level == SimdLevel::SSE2)
+            return sse2;
+
+        // AVX registers are only usable if the OS saves them (OSXSAVE, then XCR0)
+        if (!((regs1[2] >> 27) & 1))
+            return false;
+#ifdef _MSC_VER
+        unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        unsigned long long xcr0 = (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+        const bool avx2 = (regs7[1] >> 5) & 1;
+        if (level == SimdLevel::AVX2)
+            return avx2 && (xcr0 & 0x6) == 0x6;
+
+        // AVX-512F and AVX-512BW, with the opmask and upper ZMM state enabled
+        const bool avx512 = ((regs7[1] >> 16) & 1) && ((regs7[1] >> 30) & 1);
+        return avx512 && (xcr0 & 0xE6) == 0xE6;
+#else
+        return false;
+#endif
+    }
+
+    std::atomic<int>& activeLevel()
+    {
+        static std::atomic<int> level(static_cast<int>(detectSimdLevel()));
+        return level;
+    }
+
+    const CompositeKernels& activeKernels()
+    {
+        // Only levels with compiled-in kernels are ever stored
+        return *kernelsFor(static_cast<SimdLevel>(activeLevel().load(std::memory_order_relaxed)));
+    }
+}
+
+void compositeSolidSpanScalar(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage)
+{
+    const bool opaque = (colour >> 24) == 255;
+    for (int i = 0; i < count; ++i) {
+        uint32_t cover = coverage[i];
+        if (cover == 0)
+            continue;
+        dst[i] = (cover == 255 && opaque) ? colour : blendPixel(dst[i], colour, cover);
+    }
+}
+
+void compositeSpanScalar(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage)
+{
+    for (int i = 0; i < count; ++i) {
+        if (coverage[i] != 0)
+            dst[i] = blendPixel(dst[i], src[i], coverage[i]);
+    }
+}
+
+void compositeSolidSpan(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage)
+{
+    activeKernels().solid(dst, count, colour, coverage);
+}
+
+void compositeSpan(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage)
+{
+    activeKernels().span(dst, count, src, coverage);
+}
+
+SimdLevel detectSimdLevel()
+{
+    const SimdLevel levels[] = { SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE2 };
+    for (SimdLevel level : levels) {
+        if (kernelsFor(level) && cpuSupports(level))
+            return level;
+    }
+    return SimdLevel::Scalar;
+}
+
+SimdLevel compositingLevel()
+{
+    return static_cast<SimdLevel>(activeLevel().load());
+}
+
+bool setCompositingLevel(SimdLevel level)
+{
+    if (!kernelsFor(level) || !cpuSupports(level))
+        return false;
+    activeLevel().store(static_cast<int>(level));
+    return true;
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::SSE2:   return "SSE2";
+    case SimdLevel::AVX2:   return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    default:                return "scalar";
+    }
+}
@@ -0,0 +1,39 @@
+﻿// include/Compositing.h
+#pragma once
+#include <cstdint>
+
+// Premultiplied RGBA8 pixels, R in the low byte: r | g << 8 | b << 16 | a << 24
+// (the layout of SVGGradient's colour ramp).
+
+// Premultiplies a 0xRRGGBBAA colour into the pixel layout above
+uint32_t premultiplyColour(unsigned long colour);
+
+// Straight (non-premultiplied) RGBA8 bytes, R first, of 'count' pixels, as image files store them
+void unpremultiplySpan(const uint32_t* src, int count, uint8_t* out);
+// Pixels in the layout above from straight RGBA8 bytes (e.g. sf::Image's)
+void premultiplySpan(const uint8_t* src, int count, uint32_t* out);
+
+// Source-over of one colour onto 'count' pixels, each weighted by its coverage (0..255)
+void compositeSolidSpan(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage);
+
+// Source-over of per-pixel colours (e.g. shaded from a gradient ramp) weighted by coverage
+void compositeSpan(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage);
+
+// Instruction sets the span kernels above come in. Every level gives bit-identical pixels.
+enum class SimdLevel { Scalar, SSE2, AVX2, AVX512 };
+
+// Best level that is both compiled in and supported by this CPU (CPUID, and the OS saving
+// the wider registers)
+SimdLevel detectSimdLevel();
+// Level the kernels currently run at: detectSimdLevel() unless overridden
+SimdLevel compositingLevel();
+// Switches the kernels, e.g. to compare against the scalar reference; false if unavailable
+bool setCompositingLevel(SimdLevel level);
+const char* simdLevelName(SimdLevel level);
+
+// a * b / 255, rounded to nearest, exact for all 8-bit inputs
+inline uint32_t mul255(uint32_t a, uint32_t b)
+{
+    uint32_t t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+}
@@ -0,0 +1,94 @@
+﻿// src/CompositingAVX2.cpp
+#include "CompositingKernels.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#include <cstring>
+
+namespace
+{
+    // Eight pixels per step; see CompositingSSE2.cpp for the arithmetic
+    inline __m256i mul255(__m256i x, __m256i y)
+    {
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, y), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    inline __m256i blend(__m256i dst, __m256i src, __m256i cover)
+    {
+        src = mul255(src, cover);
+        __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+        return _mm256_add_epi16(mul255(dst, inverse), src);
+    }
+
+    inline long long coverageWord(const uint8_t* coverage)
+    {
+        long long word;
+        std::memcpy(&word, coverage, sizeof(word));
+        return word;
+    }
+
+    inline __m256i blend8(__m256i dst, __m256i src, long long coverageBytes)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        // Widen each coverage byte to its pixel's 32 bits, then repeat it over the four channels
+        __m256i cover = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(coverageBytes));
+        cover = _mm256_shuffle_epi8(cover, _mm256_setr_epi8(
+            0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12,
+            0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12));
+
+        // Unpacking and packing both work within 128-bit halves, so the pixel order survives
+        __m256i lo = blend(_mm256_unpacklo_epi8(dst, zero), _mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(cover, zero));
+        __m256i hi = blend(_mm256_unpackhi_epi8(dst, zero), _mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(cover, zero));
+        return _mm256_packus_epi16(lo, hi);
+    }
+
+    void solidSpan(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage)
+    {
+        const __m256i src = _mm256_set1_epi32(static_cast<int>(colour));
+        const bool opaque = (colour >> 24) == 255;
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            long long word = coverageWord(coverage + i);
+            if (word == 0)
+                continue;
+            __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+            if (word == -1 && opaque)
+                _mm256_storeu_si256(p, src);
+            else
+                _mm256_storeu_si256(p, blend8(_mm256_loadu_si256(p), src, word));
+        }
+        compositeSolidSpanScalar(dst + i, count - i, colour, coverage + i);
+    }
+
+    void span(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage)
+    {
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            long long word = coverageWord(coverage + i);
+            if (word == 0)
+                continue;
+            __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+            __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(p, blend8(_mm256_loadu_si256(p), s, word));
+        }
+        compositeSpanScalar(dst + i, count - i, src + i, coverage + i);
+    }
+
+    const CompositeKernels kernels = { solidSpan, span };
+}
+
+const CompositeKernels* avx2CompositeKernels()
+{
+    return &kernels;
+}
+
+#else
+
+const CompositeKernels* avx2CompositeKernels()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,81 @@
+﻿// src/CompositingAVX512.cpp
+#include "CompositingKernels.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#include <immintrin.h>
+
+namespace
+{
+    // Sixteen pixels per step; see CompositingSSE2.cpp for the arithmetic
+    inline __m512i mul255(__m512i x, __m512i y)
+    {
+        __m512i t = _mm512_add_epi16(_mm512_mullo_epi16(x, y), _mm512_set1_epi16(128));
+        return _mm512_srli_epi16(_mm512_add_epi16(t, _mm512_srli_epi16(t, 8)), 8);
+    }
+
+    inline __m512i blend(__m512i dst, __m512i src, __m512i cover)
+    {
+        src = mul255(src, cover);
+        __m512i alpha = _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m512i inverse = _mm512_sub_epi16(_mm512_set1_epi16(255), alpha);
+        return _mm512_add_epi16(mul255(dst, inverse), src);
+    }
+
+    inline __m512i blend16(__m512i dst, __m512i src, __m128i coverageBytes)
+    {
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i repeat = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12));
+        __m512i cover = _mm512_shuffle_epi8(_mm512_cvtepu8_epi32(coverageBytes), repeat);
+
+        __m512i lo = blend(_mm512_unpacklo_epi8(dst, zero), _mm512_unpacklo_epi8(src, zero), _mm512_unpacklo_epi8(cover, zero));
+        __m512i hi = blend(_mm512_unpackhi_epi8(dst, zero), _mm512_unpackhi_epi8(src, zero), _mm512_unpackhi_epi8(cover, zero));
+        return _mm512_packus_epi16(lo, hi);
+    }
+
+    void solidSpan(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage)
+    {
+        const __m512i src = _mm512_set1_epi32(static_cast<int>(colour));
+        const bool opaque = (colour >> 24) == 255;
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i cover = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(cover, _mm_setzero_si128())) == 0xFFFF)
+                continue;
+            void* p = dst + i;
+            if (opaque && _mm_movemask_epi8(_mm_cmpeq_epi8(cover, _mm_set1_epi8(-1))) == 0xFFFF)
+                _mm512_storeu_si512(p, src);
+            else
+                _mm512_storeu_si512(p, blend16(_mm512_loadu_si512(p), src, cover));
+        }
+        compositeSolidSpanScalar(dst + i, count - i, colour, coverage + i);
+    }
+
+    void span(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage)
+    {
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i cover = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(cover, _mm_setzero_si128())) == 0xFFFF)
+                continue;
+            void* p = dst + i;
+            _mm512_storeu_si512(p, blend16(_mm512_loadu_si512(p), _mm512_loadu_si512(src + i), cover));
+        }
+        compositeSpanScalar(dst + i, count - i, src + i, coverage + i);
+    }
+
+    const CompositeKernels kernels = { solidSpan, span };
+}
+
+const CompositeKernels* avx512CompositeKernels()
+{
+    return &kernels;
+}
+
+#else
+
+const CompositeKernels* avx512CompositeKernels()
+{
+    return nullptr;
+}
+
+#endif
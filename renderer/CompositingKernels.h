@@ -0,0 +1,20 @@
+﻿// include/CompositingKernels.h
+#pragma once
+#include <cstdint>
+
+// Span kernels behind compositeSolidSpan/compositeSpan. The SIMD variants live in their own
+// translation units built with the matching instruction-set flags, so they must not use
+// inline functions shared with the rest of the program (the linker could pick their AVX
+// copy for everyone). Each accessor returns nullptr when its variant was not compiled in.
+struct CompositeKernels {
+    void (*solid)(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage);
+    void (*span)(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage);
+};
+
+// Reference implementation, also used by the SIMD variants for their last few pixels
+void compositeSolidSpanScalar(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage);
+void compositeSpanScalar(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage);
+
+const CompositeKernels* sse2CompositeKernels();
+const CompositeKernels* avx2CompositeKernels();
+const CompositeKernels* avx512CompositeKernels();
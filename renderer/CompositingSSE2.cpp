@@ -0,0 +1,94 @@
+﻿// src/CompositingSSE2.cpp
+#include "CompositingKernels.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+namespace
+{
+    // Four pixels per step, widened to 16-bit lanes. x * y / 255 is rounded exactly as the
+    // scalar mul255(): t = x * y + 128, (t + (t >> 8)) >> 8, which never leaves 16 bits.
+    inline __m128i mul255(__m128i x, __m128i y)
+    {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    // Source-over of two widened pixels, 'cover' holding each pixel's coverage in all four lanes
+    inline __m128i blend(__m128i dst, __m128i src, __m128i cover)
+    {
+        src = mul255(src, cover);
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+        return _mm_add_epi16(mul255(dst, inverse), src);
+    }
+
+    // Coverage of four pixels as one word: 0 when none is covered, -1 when all are
+    inline int coverageWord(const uint8_t* coverage)
+    {
+        int word;
+        std::memcpy(&word, coverage, sizeof(word));
+        return word;
+    }
+
+    inline __m128i blend4(__m128i dst, __m128i src, const uint8_t* coverage)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        // Every coverage byte repeated over its pixel's four channels
+        __m128i cover = _mm_cvtsi32_si128(coverageWord(coverage));
+        cover = _mm_unpacklo_epi8(cover, cover);
+        cover = _mm_unpacklo_epi16(cover, cover);
+
+        __m128i lo = blend(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(cover, zero));
+        __m128i hi = blend(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(cover, zero));
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    void solidSpan(uint32_t* dst, int count, uint32_t colour, const uint8_t* coverage)
+    {
+        const __m128i src = _mm_set1_epi32(static_cast<int>(colour));
+        const bool opaque = (colour >> 24) == 255;
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            int word = coverageWord(coverage + i);
+            if (word == 0)
+                continue;
+            __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+            if (word == -1 && opaque)
+                _mm_storeu_si128(p, src);
+            else
+                _mm_storeu_si128(p, blend4(_mm_loadu_si128(p), src, coverage + i));
+        }
+        compositeSolidSpanScalar(dst + i, count - i, colour, coverage + i);
+    }
+
+    void span(uint32_t* dst, int count, const uint32_t* src, const uint8_t* coverage)
+    {
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            if (coverageWord(coverage + i) == 0)
+                continue;
+            __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_si128(p, blend4(_mm_loadu_si128(p), s, coverage + i));
+        }
+        compositeSpanScalar(dst + i, count - i, src + i, coverage + i);
+    }
+
+    const CompositeKernels kernels = { solidSpan, span };
+}
+
+const CompositeKernels* sse2CompositeKernels()
+{
+    return &kernels;
+}
+
+#else
+
+const CompositeKernels* sse2CompositeKernels()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,60 @@
+﻿// src/EncoderPool.cpp
+#include "EncoderPool.h"
+#include <algorithm>
+
+EncoderPool::EncoderPool(unsigned threads, size_t maxQueued)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    this->maxQueued = maxQueued ? maxQueued : 2 * static_cast<size_t>(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(&EncoderPool::workerLoop, this);
+}
+
+EncoderPool::~EncoderPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+std::future<bool> EncoderPool::submit(std::function<bool()> job)
+{
+    std::packaged_task<bool()> task(std::move(job));
+    std::future<bool> result = task.get_future();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceFree.wait(lock, [this] { return jobs.size() < maxQueued; });
+        jobs.push_back(std::move(task));
+    }
+    jobReady.notify_one();
+    return result;
+}
+
+void EncoderPool::workerLoop()
+{
+    for (;;) {
+        std::packaged_task<bool()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            // Queued jobs still run when stopping: their callers hold futures
+            if (jobs.empty())
+                return;
+            task = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        spaceFree.notify_one();
+        task();
+    }
+}
+
+std::shared_ptr<EncoderPool> EncoderPool::shared()
+{
+    static std::shared_ptr<EncoderPool> pool = std::make_shared<EncoderPool>();
+    return pool;
+}
@@ -0,0 +1,45 @@
+﻿// include/EncoderPool.h
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Background threads that encode and write images, so that rendering the next document
+// overlaps the compression of the previous one. The queue is bounded: submit() blocks while
+// it is full, which keeps a fast renderer from piling up pixel buffers faster than they are
+// written. Internally synchronised; renderers on different threads can share one pool.
+class EncoderPool
+{
+public:
+    // 0 threads: one per hardware thread; 0 maxQueued: twice the thread count
+    explicit EncoderPool(unsigned threads = 0, size_t maxQueued = 0);
+    // Finishes every job already submitted
+    ~EncoderPool();
+    EncoderPool(const EncoderPool&) = delete;
+    EncoderPool& operator=(const EncoderPool&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()); }
+
+    // Queues 'job', waiting for room first. The future holds its result, or the exception
+    // it threw.
+    std::future<bool> submit(std::function<bool()> job);
+
+    // Pool used by renderers that are not given one
+    static std::shared_ptr<EncoderPool> shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobReady, spaceFree;
+    std::deque<std::packaged_task<bool()>> jobs;
+    size_t maxQueued;
+    bool stopping = false;
+
+    void workerLoop();
+};
@@ -0,0 +1,44 @@
+﻿// src/FontCache.cpp
+#include "FontCache.h"
+#include <fstream>
+#include <iterator>
+
+std::shared_ptr<const FontCache::FontData> FontCache::get(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = fonts.find(path);
+        if (it != fonts.end())
+            return it->second;
+    }
+
+    // Read outside the lock; if two threads race on the same file the first insert wins
+    std::shared_ptr<FontData> data;
+    std::ifstream file(path, std::ios::binary);
+    if (file) {
+        data = std::make_shared<FontData>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (data->empty())
+            data.reset();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return fonts.emplace(path, data).first->second;
+}
+
+void FontCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fonts.clear();
+}
+
+size_t FontCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return fonts.size();
+}
+
+std::shared_ptr<FontCache> FontCache::shared()
+{
+    static std::shared_ptr<FontCache> cache = std::make_shared<FontCache>();
+    return cache;
+}
@@ -0,0 +1,29 @@
+﻿// include/FontCache.h
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Font files loaded once and shared between renderers. Internally synchronised, so renderers on
+// different threads can share one cache. It holds the immutable file bytes only: glyph caches
+// are mutated while drawing, so every renderer builds its own font objects on top of them.
+class FontCache
+{
+public:
+    typedef std::vector<char> FontData;
+
+    // Contents of the font file, or nullptr when it cannot be read (failures are remembered too)
+    std::shared_ptr<const FontData> get(const std::string& path);
+
+    void clear();
+    size_t size() const;
+
+    // Cache used by renderers that are not given one
+    static std::shared_ptr<FontCache> shared();
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_ptr<const FontData>> fonts;
+};
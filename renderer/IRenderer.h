@@ -3,9 +3,11 @@
 #include <vector>
 #include <utility>
 #include <string>
-#include "..\src\elements\elements.h"
+#include "../src/elements/elements.h"
 
 using namespace std;
+class SVGGradient;
+
 class IRenderer
 {
 public:
@@ -29,6 +31,10 @@ public:
     virtual void drawLinearGradient(const string& id, const Point2D& P1, const Point2D& P2, const vector<pair<float, string>>& stops) = 0;
     virtual void drawRadialGradient(const string& id, const Point2D&centre, float r, const vector<pair<float, string>>& stops) = 0;
 
+    // Draws a shared definition (the target of a <use>) under an extra transform.
+    // The same definition pointer is passed for every instance so output can be reused.
+    virtual void drawInstance(SVGElements* definition, const Transform& transform) = 0;
+
 
     // Property setting methods
     virtual void setFillColor(int r, int g, int b, int a = 255) = 0;
@@ -36,11 +42,20 @@ public:
     virtual void setStrokeWidth(float width) = 0;
     virtual void setFillGradient(const string& gradientId) = 0;
     virtual void setStrokeGradient(const string& gradientId) = 0;
+    virtual void setFillGradient(const SVGGradient& gradient) = 0;   // Parsed gradient, shared between elements
+    virtual void setStrokeGradient(const SVGGradient& gradient) = 0;
     virtual void setFillColor(const std::string& css) = 0;
     virtual void setStrokeColor(const std::string& css) = 0;
+    virtual void setFillRule(FillRule rule) = 0;
+    virtual void setStrokeStyle(const StrokeStyle& style) = 0; // Caps, joins, miter limit, dashes
+
+    // Cache of the element whose geometry the next draw call receives (nullptr: none).
+    // The renderer may keep derived geometry there; it forgets the pointer after that call.
+    virtual void setRenderCache(RenderCache* cache) = 0;
 
     // New methods for transformations & grouping
     virtual void pushTransform(const string& transformStr) = 0;
+    virtual void pushTransform(const Transform& transform) = 0; // Already parsed, e.g. by SVGParser
     virtual void popTransform() = 0;
 
     virtual void beginGroup() = 0;
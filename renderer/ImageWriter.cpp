@@ -0,0 +1,244 @@
+﻿// src/ImageWriter.cpp
+#include "ImageWriter.h"
+#include "Compositing.h"
+#include <vector>
+#include <cstring>
+
+namespace
+{
+    bool hasExtension(const std::string& path, const char* lower, const char* upper)
+    {
+        const size_t n = std::strlen(lower);
+        return path.size() >= n && (path.compare(path.size() - n, n, lower) == 0 || path.compare(path.size() - n, n, upper) == 0);
+    }
+
+    void putLittleEndian(uint8_t* out, uint32_t value)
+    {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out[2] = static_cast<uint8_t>(value >> 16);
+        out[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    // One row of the image at a time, in whichever alpha convention the format stores
+    class RowReader
+    {
+    public:
+        RowReader(const uint32_t* pixels, int width, bool premultiplied)
+            : pixels(pixels), width(width), premultiplied(premultiplied), converted(static_cast<size_t>(width)) {}
+
+        // Premultiplied pixels (the Compositing.h layout)
+        const uint32_t* premultipliedRow(int y)
+        {
+            const uint32_t* src = row(y);
+            if (premultiplied)
+                return src;
+            premultiplySpan(reinterpret_cast<const uint8_t*>(src), width, converted.data());
+            return converted.data();
+        }
+
+        // Straight RGBA8 bytes, R first
+        const uint8_t* straightRow(int y)
+        {
+            const uint32_t* src = row(y);
+            if (!premultiplied)
+                return reinterpret_cast<const uint8_t*>(src);
+            uint8_t* out = reinterpret_cast<uint8_t*>(converted.data());
+            unpremultiplySpan(src, width, out);
+            return out;
+        }
+
+    private:
+        const uint32_t* pixels;
+        int width;
+        bool premultiplied;
+        std::vector<uint32_t> converted;
+
+        const uint32_t* row(int y) const { return pixels + static_cast<size_t>(y) * width; }
+    };
+
+    bool writeRaw(BufferedWriter& out, RowReader& rows, int width, int height)
+    {
+        uint8_t header[16] = { 'R', 'G', 'B', 'A' };
+        putLittleEndian(header + 4, static_cast<uint32_t>(width));
+        putLittleEndian(header + 8, static_cast<uint32_t>(height));
+        putLittleEndian(header + 12, RawImageHeader::Premultiplied);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for (int y = 0; y < height && out.good(); ++y)
+            out.write(reinterpret_cast<const char*>(rows.premultipliedRow(y)), static_cast<size_t>(width) * 4);
+        return out.flush();
+    }
+
+    bool writePpm(BufferedWriter& out, RowReader& rows, int width, int height)
+    {
+        // Premultiplied colour channels are the image composited over black
+        out << "P6\n" << width << ' ' << height << "\n255\n";
+        std::vector<char> rgb(static_cast<size_t>(width) * 3);
+        for (int y = 0; y < height && out.good(); ++y) {
+            const uint32_t* src = rows.premultipliedRow(y);
+            char* dst = rgb.data();
+            for (int x = 0; x < width; ++x) {
+                *dst++ = static_cast<char>(src[x]);
+                *dst++ = static_cast<char>(src[x] >> 8);
+                *dst++ = static_cast<char>(src[x] >> 16);
+            }
+            out.write(rgb.data(), rgb.size());
+        }
+        return out.flush();
+    }
+
+    bool writePam(BufferedWriter& out, RowReader& rows, int width, int height)
+    {
+        out << "P7\nWIDTH " << width << "\nHEIGHT " << height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+        for (int y = 0; y < height && out.good(); ++y)
+            out.write(reinterpret_cast<const char*>(rows.straightRow(y)), static_cast<size_t>(width) * 4);
+        return out.flush();
+    }
+
+    // Encoder of the QOI specification 1.0 (qoiformat.org)
+    class QoiEncoder
+    {
+    public:
+        explicit QoiEncoder(BufferedWriter& out) : out(out) {}
+
+        void header(int width, int height)
+        {
+            const uint32_t w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+            const uint8_t bytes[14] = {
+                'q', 'o', 'i', 'f',
+                uint8_t(w >> 24), uint8_t(w >> 16), uint8_t(w >> 8), uint8_t(w),
+                uint8_t(h >> 24), uint8_t(h >> 16), uint8_t(h >> 8), uint8_t(h),
+                4, // RGBA
+                0, // sRGB colour, linear alpha
+            };
+            out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+        }
+
+        void encode(const uint8_t* rgba, int count)
+        {
+            for (int i = 0; i < count; ++i, rgba += 4) {
+                const uint8_t r = rgba[0], g = rgba[1], b = rgba[2], a = rgba[3];
+                if (r == pr && g == pg && b == pb && a == pa) {
+                    if (++run == 62)
+                        flushRun();
+                    continue;
+                }
+                flushRun();
+
+                const int slot = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+                uint8_t* entry = index[slot];
+                if (entry[0] == r && entry[1] == g && entry[2] == b && entry[3] == a) {
+                    out.put(static_cast<char>(slot)); // QOI_OP_INDEX
+                }
+                else {
+                    entry[0] = r; entry[1] = g; entry[2] = b; entry[3] = a;
+                    if (a == pa) {
+                        const int dr = static_cast<int8_t>(r - pr), dg = static_cast<int8_t>(g - pg), db = static_cast<int8_t>(b - pb);
+                        const int drg = dr - dg, dbg = db - dg;
+                        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                            out.put(static_cast<char>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2))); // QOI_OP_DIFF
+                        }
+                        else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                            out.put(static_cast<char>(0x80 | (dg + 32))); // QOI_OP_LUMA
+                            out.put(static_cast<char>((drg + 8) << 4 | (dbg + 8)));
+                        }
+                        else {
+                            out.put(static_cast<char>(0xFE)); // QOI_OP_RGB
+                            out.put(static_cast<char>(r));
+                            out.put(static_cast<char>(g));
+                            out.put(static_cast<char>(b));
+                        }
+                    }
+                    else {
+                        out.put(static_cast<char>(0xFF)); // QOI_OP_RGBA
+                        out.put(static_cast<char>(r));
+                        out.put(static_cast<char>(g));
+                        out.put(static_cast<char>(b));
+                        out.put(static_cast<char>(a));
+                    }
+                }
+                pr = r; pg = g; pb = b; pa = a;
+            }
+        }
+
+        void finish()
+        {
+            flushRun();
+            static const char end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+            out.write(end, sizeof(end));
+        }
+
+    private:
+        BufferedWriter& out;
+        uint8_t index[64][4] = {};
+        uint8_t pr = 0, pg = 0, pb = 0, pa = 255; // Previous pixel
+        int run = 0;
+
+        void flushRun()
+        {
+            if (run > 0) {
+                out.put(static_cast<char>(0xC0 | (run - 1))); // QOI_OP_RUN
+                run = 0;
+            }
+        }
+    };
+
+    bool writeQoi(BufferedWriter& out, RowReader& rows, int width, int height)
+    {
+        QoiEncoder encoder(out);
+        encoder.header(width, height);
+        for (int y = 0; y < height && out.good(); ++y)
+            encoder.encode(rows.straightRow(y), width);
+        encoder.finish();
+        return out.flush();
+    }
+}
+
+bool imageFormatForPath(const std::string& path, ImageFormat& format)
+{
+    if (hasExtension(path, ".png", ".PNG"))
+        format = ImageFormat::Png;
+    else if (hasExtension(path, ".raw", ".RAW") || hasExtension(path, ".rgba", ".RGBA"))
+        format = ImageFormat::Raw;
+    else if (hasExtension(path, ".ppm", ".PPM"))
+        format = ImageFormat::Ppm;
+    else if (hasExtension(path, ".pam", ".PAM"))
+        format = ImageFormat::Pam;
+    else if (hasExtension(path, ".qoi", ".QOI"))
+        format = ImageFormat::Qoi;
+    else
+        return false;
+    return true;
+}
+
+bool writeImage(IOutputSink& sink, ImageFormat format, const uint32_t* pixels, int width, int height, const PngOptions& options)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+    if (format == ImageFormat::Auto || format == ImageFormat::Png)
+        return writePng(sink, pixels, width, height, options);
+
+    BufferedWriter out(&sink);
+    RowReader rows(pixels, width, options.premultiplied);
+    switch (format) {
+    case ImageFormat::Raw:
+        return writeRaw(out, rows, width, height);
+    case ImageFormat::Ppm:
+        return writePpm(out, rows, width, height);
+    case ImageFormat::Pam:
+        return writePam(out, rows, width, height);
+    default:
+        return writeQoi(out, rows, width, height);
+    }
+}
+
+bool saveImage(const std::string& path, ImageFormat format, const uint32_t* pixels, int width, int height, const PngOptions& options)
+{
+    if (format == ImageFormat::Auto && !imageFormatForPath(path, format))
+        format = ImageFormat::Png;
+    std::unique_ptr<FileDescriptorSink> file = FileDescriptorSink::open(path);
+    if (!file)
+        return false;
+    bool ok = writeImage(*file, format, pixels, width, height, options);
+    return file->close() && ok;
+}
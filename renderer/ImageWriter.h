@@ -0,0 +1,40 @@
+﻿// include/ImageWriter.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include "OutputSink.h"
+#include "PngWriter.h"
+
+// Image file formats of the raster renderers. All but PNG cost next to nothing to encode,
+// for images that are decoded again straight away.
+enum class ImageFormat {
+    Auto, // From the file extension (imageFormatForPath), PNG when it is not recognised
+    Png,
+    Raw,  // RawImageHeader, then premultiplied RGBA8 rows (the Compositing.h layout)
+    Ppm,  // Binary PPM (P6): RGB without alpha, composited over black
+    Pam,  // PAM (P7) RGB_ALPHA: straight RGBA8
+    Qoi,  // "Quite OK Image" format: lossless, straight RGBA8, sRGB
+};
+
+// Header of ImageFormat::Raw files: 16 bytes, little-endian, followed by height rows of
+// width * 4 bytes (R, G, B, A, premultiplied) top to bottom without padding
+struct RawImageHeader {
+    static const uint32_t Premultiplied = 1;
+
+    char magic[4];   // "RGBA"
+    uint32_t width;
+    uint32_t height;
+    uint32_t flags;  // Premultiplied, always set
+};
+
+// Format for the extension of 'path' (.raw/.rgba, .ppm, .pam, .qoi, .png, any case).
+// False, leaving 'format' alone, for any other extension.
+bool imageFormatForPath(const std::string& path, ImageFormat& format);
+
+// Encodes the pixels in 'format' (Auto means PNG) and writes them to the sink a row at a time.
+// 'options.premultiplied' describes the input pixels for every format; the rest of the
+// options only matter to PNG.
+bool writeImage(IOutputSink& sink, ImageFormat format, const uint32_t* pixels, int width, int height, const PngOptions& options = PngOptions());
+
+// writeImage() into a new file at 'path'; Auto picks the format from the extension
+bool saveImage(const std::string& path, ImageFormat format, const uint32_t* pixels, int width, int height, const PngOptions& options = PngOptions());
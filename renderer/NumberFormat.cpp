@@ -0,0 +1,191 @@
+﻿// src/NumberFormat.cpp
+#include "NumberFormat.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    // Exact powers of ten up to 1e22, computed ones beyond
+    double pow10(int n)
+    {
+        static const double table[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        return n <= 22 ? table[n] : std::pow(10.0, n);
+    }
+
+    // Writes 'value' in decimal, returns the length
+    size_t writeUnsigned(uint64_t value, char* out)
+    {
+        char digits[20];
+        size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        for (size_t i = 0; i < n; ++i)
+            out[i] = digits[n - 1 - i];
+        return n;
+    }
+
+    // Lays out digits * 10^scale as a plain decimal, or in exponent form when that is far shorter
+    size_t writeDecimal(const char* digits, size_t count, int scale, char* out)
+    {
+        char* p = out;
+        int point = static_cast<int>(count) + scale; // Digits before the decimal point
+        if (scale >= 0 && point <= 21) {
+            std::memcpy(p, digits, count);
+            p += count;
+            for (int i = 0; i < scale; ++i)
+                *p++ = '0';
+        }
+        else if (point > 0 && point <= 21) {
+            std::memcpy(p, digits, point);
+            p += point;
+            *p++ = '.';
+            std::memcpy(p, digits + point, count - point);
+            p += count - point;
+        }
+        else if (point <= 0 && point > -6) {
+            *p++ = '0';
+            *p++ = '.';
+            for (int i = point; i < 0; ++i)
+                *p++ = '0';
+            std::memcpy(p, digits, count);
+            p += count;
+        }
+        else {
+            *p++ = digits[0];
+            if (count > 1) {
+                *p++ = '.';
+                std::memcpy(p, digits + 1, count - 1);
+                p += count - 1;
+            }
+            *p++ = 'e';
+            int exponent = point - 1;
+            if (exponent < 0) {
+                *p++ = '-';
+                exponent = -exponent;
+            }
+            p += writeUnsigned(static_cast<uint64_t>(exponent), p);
+        }
+        return p - out;
+    }
+}
+
+size_t formatShortest(float value, char* out)
+{
+    if (value == 0.0f || !std::isfinite(value)) { // SVG has no NaN or infinity
+        out[0] = '0';
+        return 1;
+    }
+
+    char* p = out;
+    if (value < 0.0f) {
+        *p++ = '-';
+        value = -value;
+    }
+
+    // Try 1..9 significant digits; 9 always reads back as the same float
+    const double v = value;
+    const int exponent = static_cast<int>(std::floor(std::log10(v)));
+    for (int precision = 1; precision <= 9; ++precision) {
+        int scale = exponent - precision + 1; // v ~ digits * 10^scale
+        double digits = std::floor((scale >= 0 ? v / pow10(scale) : v * pow10(-scale)) + 0.5);
+        double back = scale >= 0 ? digits * pow10(scale) : digits / pow10(-scale);
+        if (static_cast<float>(back) != value)
+            continue;
+
+        char text[20];
+        size_t count = writeUnsigned(static_cast<uint64_t>(digits), text);
+        while (count > 1 && text[count - 1] == '0') {
+            --count;
+            ++scale;
+        }
+        return (p - out) + writeDecimal(text, count, scale, p);
+    }
+
+    // Only reached when the estimate above is off (subnormals): let the C library do it
+    return (p - out) + std::snprintf(p, NumberFormat::MaxLength - 1, "%.9g", v);
+}
+
+size_t formatFixed(float value, int decimals, char* out)
+{
+    decimals = decimals < 0 ? 0 : (decimals > 9 ? 9 : decimals);
+    if (!std::isfinite(value)) {
+        out[0] = '0';
+        return 1;
+    }
+
+    double scaled = std::floor(std::fabs(static_cast<double>(value)) * pow10(decimals) + 0.5);
+    if (scaled >= 1e18) // Beyond the integer path: no fractional digits survive anyway
+        return formatShortest(value, out);
+    if (scaled == 0.0) {
+        out[0] = '0'; // Never "-0"
+        return 1;
+    }
+
+    char* p = out;
+    if (value < 0.0f)
+        *p++ = '-';
+
+    uint64_t n = static_cast<uint64_t>(scaled);
+    uint64_t unit = static_cast<uint64_t>(pow10(decimals));
+    p += writeUnsigned(n / unit, p);
+
+    uint64_t fraction = n % unit;
+    if (fraction != 0) {
+        *p++ = '.';
+        int width = decimals;
+        while (fraction % 10 == 0) { // Trim trailing zeros
+            fraction /= 10;
+            --width;
+        }
+        char text[20];
+        size_t count = writeUnsigned(fraction, text);
+        for (size_t i = count; i < static_cast<size_t>(width); ++i)
+            *p++ = '0';
+        std::memcpy(p, text, count);
+        p += count;
+    }
+    return p - out;
+}
+
+size_t NumberFormat::format(float value, char* out) const
+{
+    size_t length = mode == NumberFormatMode::FixedPrecision ? formatFixed(value, precision, out) : formatShortest(value, out);
+    if (!leadingZero) {
+        size_t zero = (out[0] == '-') ? 1 : 0;
+        if (length > zero + 2 && out[zero] == '0' && out[zero + 1] == '.') {
+            std::memmove(out + zero, out + zero + 1, length - zero - 1);
+            --length;
+        }
+    }
+    return length;
+}
+
+float NumberFormat::quantize(float value) const
+{
+    if (mode != NumberFormatMode::FixedPrecision || !std::isfinite(value))
+        return value; // Shortest round-trip reads back exactly
+    int decimals = precision < 0 ? 0 : (precision > 9 ? 9 : precision);
+    double scale = pow10(decimals);
+    return static_cast<float>(std::floor(std::fabs(static_cast<double>(value)) * scale + 0.5) / scale) * (value < 0.0f ? -1.0f : 1.0f);
+}
+
+std::string NumberFormat::toString(float value) const
+{
+    char text[MaxLength];
+    return std::string(text, format(value, text));
+}
+
+NumberFormat NumberFormat::fixed(int decimals)
+{
+    NumberFormat numberFormat;
+    numberFormat.mode = NumberFormatMode::FixedPrecision;
+    numberFormat.precision = decimals;
+    return numberFormat;
+}
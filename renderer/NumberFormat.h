@@ -0,0 +1,31 @@
+﻿// include/NumberFormat.h
+#pragma once
+#include <cstddef>
+#include <string>
+
+enum class NumberFormatMode {
+    ShortestRoundTrip, // Fewest digits that read back as the same float
+    FixedPrecision     // 'precision' decimals, trailing zeros trimmed
+};
+
+// Locale-independent number formatting for serialised output.
+// Writes into a caller buffer of at least MaxLength characters and returns the length.
+struct NumberFormat {
+    static const size_t MaxLength = 32;
+
+    NumberFormatMode mode = NumberFormatMode::ShortestRoundTrip;
+    int precision = 3;        // Decimals in FixedPrecision mode (0..9)
+    bool leadingZero = true;  // "0.5" rather than ".5"
+
+    size_t format(float value, char* out) const;
+    std::string toString(float value) const;
+
+    // The value a reader gets back from the formatted text
+    float quantize(float value) const;
+
+    static NumberFormat shortest() { return NumberFormat(); }
+    static NumberFormat fixed(int decimals);
+};
+
+size_t formatShortest(float value, char* out);
+size_t formatFixed(float value, int decimals, char* out);
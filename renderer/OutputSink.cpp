@@ -0,0 +1,324 @@
+﻿// src/OutputSink.cpp
+#include "OutputSink.h"
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <fcntl.h>
+#ifdef SVGREADER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+bool MemorySink::writev(const OutputBuffer* buffers, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        content.append(buffers[i].data, buffers[i].size);
+    return true;
+}
+
+std::unique_ptr<FileDescriptorSink> FileDescriptorSink::open(const std::string& path)
+{
+#ifdef _WIN32
+    int fd = ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0)
+        return nullptr;
+    return std::unique_ptr<FileDescriptorSink>(new FileDescriptorSink(fd, true));
+}
+
+FileDescriptorSink::FileDescriptorSink(int fd, bool ownsDescriptor)
+    : fd(fd), ownsDescriptor(ownsDescriptor)
+{
+}
+
+FileDescriptorSink::~FileDescriptorSink()
+{
+    close();
+}
+
+bool FileDescriptorSink::close()
+{
+    bool closed = true;
+    if (ownsDescriptor && fd >= 0) {
+#ifdef _WIN32
+        closed = ::_close(fd) == 0;
+#else
+        closed = ::close(fd) == 0;
+#endif
+    }
+    fd = -1;
+    return closed;
+}
+
+#ifdef _WIN32
+bool FileDescriptorSink::writev(const OutputBuffer* buffers, size_t count)
+{
+    // No writev on Windows: one write per buffer
+    if (fd < 0)
+        return false;
+    for (size_t i = 0; i < count; ++i) {
+        const char* data = buffers[i].data;
+        size_t left = buffers[i].size;
+        while (left > 0) {
+            unsigned chunk = static_cast<unsigned>(std::min<size_t>(left, 1u << 30));
+            int n = ::_write(fd, data, chunk);
+            if (n <= 0)
+                return false;
+            data += n;
+            left -= n;
+        }
+    }
+    return true;
+}
+#else
+bool FileDescriptorSink::writev(const OutputBuffer* buffers, size_t count)
+{
+    if (fd < 0)
+        return false;
+#ifdef IOV_MAX
+    const size_t MaxVectors = IOV_MAX < 64 ? IOV_MAX : 64;
+#else
+    const size_t MaxVectors = 16;
+#endif
+    struct iovec vectors[64];
+    size_t next = 0;   // First buffer not yet handed to the kernel
+    size_t offset = 0; // Bytes of buffers[next] already written
+    while (next < count) {
+        size_t n = 0;
+        for (size_t i = next; i < count && n < MaxVectors; ++i, ++n) {
+            size_t skip = (i == next) ? offset : 0;
+            vectors[n].iov_base = const_cast<char*>(buffers[i].data + skip);
+            vectors[n].iov_len = buffers[i].size - skip;
+        }
+
+        ssize_t done = ::writev(fd, vectors, static_cast<int>(n));
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        // Advance past what was written; short writes resume mid-buffer
+        size_t left = static_cast<size_t>(done);
+        while (next < count && left >= buffers[next].size - offset) {
+            left -= buffers[next].size - offset;
+            offset = 0;
+            ++next;
+        }
+        offset += left;
+    }
+    return true;
+}
+#endif
+
+#ifdef SVGREADER_HAVE_ZLIB
+struct GzipSink::Stream {
+    z_stream z;
+    bool open = false;
+    unsigned char out[64 * 1024];
+};
+
+bool GzipSink::available()
+{
+    return true;
+}
+
+GzipSink::GzipSink(std::unique_ptr<IOutputSink> target, int level)
+    : stream(new Stream()), target(std::move(target))
+{
+    level = level < 0 ? 0 : (level > 9 ? 9 : level);
+    // windowBits 15 + 16: gzip header and trailer instead of a zlib wrapper
+    stream->open = deflateInit2(&stream->z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+GzipSink::~GzipSink()
+{
+    close();
+}
+
+bool GzipSink::writev(const OutputBuffer* buffers, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (!deflateInto(buffers[i].data, buffers[i].size, false))
+            return false;
+    }
+    return true;
+}
+
+bool GzipSink::close()
+{
+    if (!stream->open)
+        return false;
+    bool ok = deflateInto(nullptr, 0, true);
+    deflateEnd(&stream->z);
+    stream->open = false;
+    return target->close() && ok;
+}
+
+bool GzipSink::deflateInto(const char* data, size_t size, bool finish)
+{
+    if (!stream->open)
+        return false;
+
+    z_stream& z = stream->z;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    do {
+        // avail_in is 32-bit: feed very large buffers in pieces
+        uInt chunk = static_cast<uInt>(std::min<size_t>(size, 1u << 30));
+        z.avail_in = chunk;
+        size -= chunk;
+        int flush = (finish && size == 0) ? Z_FINISH : Z_NO_FLUSH;
+        int status;
+        do {
+            z.next_out = stream->out;
+            z.avail_out = sizeof(stream->out);
+            status = deflate(&z, flush);
+            if (status == Z_STREAM_ERROR)
+                return false;
+            size_t produced = sizeof(stream->out) - z.avail_out;
+            if (produced > 0 && !target->write(reinterpret_cast<const char*>(stream->out), produced))
+                return false;
+        } while (z.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+    } while (size > 0);
+    return true;
+}
+#else
+struct GzipSink::Stream {};
+
+bool GzipSink::available()
+{
+    return false;
+}
+
+GzipSink::GzipSink(std::unique_ptr<IOutputSink> target, int)
+    : target(std::move(target))
+{
+}
+
+GzipSink::~GzipSink()
+{
+    close();
+}
+
+bool GzipSink::writev(const OutputBuffer*, size_t)
+{
+    return false;
+}
+
+bool GzipSink::close()
+{
+    if (target)
+        target->close();
+    return false;
+}
+
+bool GzipSink::deflateInto(const char*, size_t, bool)
+{
+    return false;
+}
+#endif
+
+BufferedWriter::BufferedWriter(IOutputSink* sink, size_t capacity)
+    : sink(sink), buffer(new char[capacity > 0 ? capacity : 1]), capacity(capacity > 0 ? capacity : 1)
+{
+}
+
+void BufferedWriter::setSink(IOutputSink* newSink)
+{
+    flush();
+    sink = newSink;
+    ok = true;
+}
+
+bool BufferedWriter::flush()
+{
+    if (used > 0) {
+        ok = sink->write(buffer.get(), used) && ok;
+        written += used;
+        used = 0;
+    }
+    return ok;
+}
+
+void BufferedWriter::write(const char* data, size_t size)
+{
+    if (size <= capacity - used) {
+        std::memcpy(buffer.get() + used, data, size);
+        used += size;
+        return;
+    }
+
+    if (size < capacity) {
+        flush();
+        std::memcpy(buffer.get(), data, size);
+        used = size;
+        return;
+    }
+
+    // Too big to buffer: hand both pieces to the sink in a single call
+    OutputBuffer pieces[2] = { { buffer.get(), used }, { data, size } };
+    ok = sink->writev(pieces, 2) && ok;
+    written += used + size;
+    used = 0;
+}
+
+BufferedWriter& BufferedWriter::operator<<(const char* text)
+{
+    write(text, std::strlen(text));
+    return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(int value)
+{
+    return *this << static_cast<long>(value);
+}
+
+BufferedWriter& BufferedWriter::operator<<(long value)
+{
+    char text[24];
+    int n = std::snprintf(text, sizeof(text), "%ld", value);
+    write(text, n);
+    return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(unsigned value)
+{
+    return *this << static_cast<unsigned long long>(value);
+}
+
+BufferedWriter& BufferedWriter::operator<<(unsigned long value)
+{
+    return *this << static_cast<unsigned long long>(value);
+}
+
+BufferedWriter& BufferedWriter::operator<<(unsigned long long value)
+{
+    char text[24];
+    int n = std::snprintf(text, sizeof(text), "%llu", value);
+    write(text, n);
+    return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(float value)
+{
+    // Formatted in place, straight into the buffer
+    if (capacity - used < NumberFormat::MaxLength) {
+        flush();
+        if (capacity < NumberFormat::MaxLength) {
+            char text[NumberFormat::MaxLength];
+            write(text, numberFormat.format(value, text));
+            return *this;
+        }
+    }
+    used += numberFormat.format(value, buffer.get() + used);
+    return *this;
+}
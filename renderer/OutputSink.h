@@ -0,0 +1,138 @@
+﻿// include/OutputSink.h
+#pragma once
+#include <cstddef>
+#include <string>
+#include <memory>
+#include "NumberFormat.h"
+
+// One piece of a scatter-gather write
+struct OutputBuffer {
+    const char* data;
+    size_t size;
+};
+
+// Destination of serialised output (a file, a socket, memory...)
+class IOutputSink
+{
+public:
+    virtual ~IOutputSink() = default;
+
+    // Writes the buffers in order; false on an I/O error
+    virtual bool writev(const OutputBuffer* buffers, size_t count) = 0;
+    virtual bool close() { return true; }
+
+    bool write(const char* data, size_t size)
+    {
+        OutputBuffer buffer{ data, size };
+        return writev(&buffer, 1);
+    }
+};
+
+// Keeps everything in memory, for callers who want the document as a buffer
+class MemorySink : public IOutputSink
+{
+public:
+    bool writev(const OutputBuffer* buffers, size_t count) override;
+
+    const std::string& str() const { return content; }
+    void clear() { content.clear(); }
+
+private:
+    std::string content;
+};
+
+// Unbuffered writes to a file descriptor with write(2)/writev(2); pair it with a BufferedWriter
+class FileDescriptorSink : public IOutputSink
+{
+public:
+    // Creates/truncates 'path'; nullptr if it cannot be opened
+    static std::unique_ptr<FileDescriptorSink> open(const std::string& path);
+
+    explicit FileDescriptorSink(int fd, bool ownsDescriptor = false);
+    ~FileDescriptorSink() override;
+
+    bool writev(const OutputBuffer* buffers, size_t count) override;
+    bool close() override;
+
+private:
+    int fd;
+    bool ownsDescriptor;
+};
+
+// Compresses everything into a gzip stream (.svgz) written to another sink.
+// Needs zlib (SVGREADER_HAVE_ZLIB); without it available() is false and every write fails.
+class GzipSink : public IOutputSink
+{
+public:
+    static const int DefaultLevel = 6;
+
+    static bool available();
+
+    // 'level' is the zlib level: 0 (store) .. 9 (smallest)
+    explicit GzipSink(std::unique_ptr<IOutputSink> target, int level = DefaultLevel);
+    ~GzipSink() override;
+
+    bool writev(const OutputBuffer* buffers, size_t count) override;
+    // Finishes the gzip stream and closes the target
+    bool close() override;
+
+private:
+    struct Stream;
+    std::unique_ptr<Stream> stream;
+    std::unique_ptr<IOutputSink> target;
+
+    bool deflateInto(const char* data, size_t size, bool finish);
+};
+
+// Fixed-size buffer in front of a sink. Memory use stays constant however much is written;
+// writes larger than the buffer go straight to the sink.
+class BufferedWriter
+{
+public:
+    static const size_t DefaultCapacity = 256 * 1024;
+
+    explicit BufferedWriter(IOutputSink* sink, size_t capacity = DefaultCapacity);
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    // Flushes what is buffered to the old sink first
+    void setSink(IOutputSink* newSink);
+    IOutputSink* getSink() const { return sink; }
+
+    void write(const char* data, size_t size);
+    void put(char c)
+    {
+        if (used == capacity)
+            flush();
+        buffer[used++] = c;
+    }
+    bool flush();
+
+    // How floats are written (shortest round-trip by default)
+    void setNumberFormat(const NumberFormat& format) { numberFormat = format; }
+    const NumberFormat& getNumberFormat() const { return numberFormat; }
+
+    // False once the sink has reported an error
+    bool good() const { return ok; }
+    size_t bytesWritten() const { return written + used; }
+
+    BufferedWriter& operator<<(const char* text);
+    BufferedWriter& operator<<(const std::string& text) { write(text.data(), text.size()); return *this; }
+    BufferedWriter& operator<<(char c) { put(c); return *this; }
+    BufferedWriter& operator<<(int value);
+    BufferedWriter& operator<<(long value);
+    BufferedWriter& operator<<(unsigned value);
+    BufferedWriter& operator<<(unsigned long value);
+    BufferedWriter& operator<<(unsigned long long value);
+    BufferedWriter& operator<<(float value);
+    BufferedWriter& operator<<(double value) { return *this << static_cast<float>(value); } // Output numbers are single precision
+
+private:
+    IOutputSink* sink;
+    std::unique_ptr<char[]> buffer;
+    size_t capacity;
+    size_t used = 0;
+    size_t written = 0;
+    bool ok = true;
+    NumberFormat numberFormat;
+};
@@ -0,0 +1,415 @@
+﻿// src/PngWriter.cpp
+#include "PngWriter.h"
+#include "Compositing.h"
+#include "WorkStealingPool.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#ifdef SVGREADER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+    // Filtered scanlines handed to deflate at a time by the serial encoders
+    const size_t GroupBytes = 64 * 1024;
+    // Scanlines compressed by one task of the parallel encoder
+    const size_t ChunkBytes = 256 * 1024;
+    // Deflate's window: how much preceding data primes each parallel chunk
+    const size_t WindowBytes = 32 * 1024;
+
+    uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        struct Table {
+            uint32_t entries[256];
+            Table()
+            {
+                for (uint32_t n = 0; n < 256; ++n) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; ++k)
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    entries[n] = c;
+                }
+            }
+        };
+        static const Table table;
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    uint32_t adler32Update(uint32_t adler, const uint8_t* data, size_t size)
+    {
+        // 64-bit sums cannot overflow within a block this size, so they are reduced once per block
+        const size_t Block = 1 << 20;
+        uint64_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+        while (size > 0) {
+            size_t n = std::min(size, Block);
+            for (size_t i = 0; i < n; ++i) {
+                s1 += data[i];
+                s2 += s1;
+            }
+            s1 %= 65521;
+            s2 %= 65521;
+            data += n;
+            size -= n;
+        }
+        return static_cast<uint32_t>((s2 << 16) | s1);
+    }
+
+    void putBigEndian(uint8_t* out, uint32_t value)
+    {
+        out[0] = static_cast<uint8_t>(value >> 24);
+        out[1] = static_cast<uint8_t>(value >> 16);
+        out[2] = static_cast<uint8_t>(value >> 8);
+        out[3] = static_cast<uint8_t>(value);
+    }
+
+    bool writeChunk(IOutputSink& sink, const char* type, const uint8_t* data, size_t size)
+    {
+        uint8_t head[8], tail[4];
+        putBigEndian(head, static_cast<uint32_t>(size));
+        std::copy(type, type + 4, head + 4);
+        uint32_t crc = crc32Update(0, head + 4, 4);
+        putBigEndian(tail, crc32Update(crc, data, size));
+
+        OutputBuffer buffers[] = {
+            { reinterpret_cast<const char*>(head), sizeof(head) },
+            { reinterpret_cast<const char*>(data), size },
+            { reinterpret_cast<const char*>(tail), sizeof(tail) },
+        };
+        return sink.writev(buffers, 3);
+    }
+
+    // Scanlines as PNG stores them: a filter byte, then the filtered straight RGBA of the row
+    class RowFilter
+    {
+    public:
+        RowFilter(const uint32_t* pixels, int width, const PngOptions& options)
+            : pixels(pixels), width(width), rowBytes(static_cast<size_t>(width) * 4), options(options),
+            previous(rowBytes), current(rowBytes), best(rowBytes), trial(rowBytes) {}
+
+        size_t scanlineBytes() const { return rowBytes + 1; }
+
+        // Appends the scanlines of rows [y0, y1) to 'out'
+        void filterRows(int y0, int y1, std::vector<uint8_t>& out)
+        {
+            if (y0 > 0)
+                straightRow(y0 - 1, previous.data());
+            else
+                std::fill(previous.begin(), previous.end(), 0);
+
+            for (int y = y0; y < y1; ++y) {
+                straightRow(y, current.data());
+                uint8_t type = chooseFilter();
+                out.push_back(type);
+                out.insert(out.end(), best.begin(), best.end());
+                previous.swap(current);
+            }
+        }
+
+    private:
+        enum Filter : uint8_t { None, Sub, Up, Average, Paeth };
+
+        const uint32_t* pixels;
+        int width;
+        size_t rowBytes;
+        PngOptions options;
+        std::vector<uint8_t> previous, current, best, trial;
+
+        void straightRow(int y, uint8_t* out) const
+        {
+            const uint32_t* src = pixels + static_cast<size_t>(y) * width;
+            if (options.premultiplied)
+                unpremultiplySpan(src, width, out);
+            else
+                std::memcpy(out, src, rowBytes);
+        }
+
+        void applyFilter(uint8_t type, uint8_t* out) const
+        {
+            const uint8_t* row = current.data();
+            const uint8_t* up = previous.data();
+            const size_t n = rowBytes;
+            switch (type) {
+            case None:
+                std::memcpy(out, row, n);
+                break;
+            case Sub:
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - (i >= 4 ? row[i - 4] : 0));
+                break;
+            case Up:
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - up[i]);
+                break;
+            case Average:
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - (((i >= 4 ? row[i - 4] : 0) + up[i]) >> 1));
+                break;
+            case Paeth:
+                for (size_t i = 0; i < n; ++i) {
+                    int a = i >= 4 ? row[i - 4] : 0, b = up[i], c = i >= 4 ? up[i - 4] : 0;
+                    int p = a + b - c;
+                    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                    int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                    out[i] = static_cast<uint8_t>(row[i] - predictor);
+                }
+                break;
+            }
+        }
+
+        // Leaves the filtered row in 'best' and returns its filter type
+        uint8_t chooseFilter()
+        {
+            if (options.effort == PngEffort::Store || options.effort == PngEffort::Fast) {
+                uint8_t type = options.effort == PngEffort::Store ? None : Sub;
+                applyFilter(type, best.data());
+                return type;
+            }
+
+            // The libpng heuristic: the filter whose output, read as signed bytes, sums smallest
+            uint8_t bestType = None;
+            uint64_t bestScore = UINT64_MAX;
+            for (uint8_t type = None; type <= Paeth; ++type) {
+                applyFilter(type, trial.data());
+                uint64_t score = 0;
+                for (uint8_t v : trial)
+                    score += v < 128 ? v : 256 - v;
+                if (score < bestScore) {
+                    bestScore = score;
+                    bestType = type;
+                    best.swap(trial);
+                }
+            }
+            return bestType;
+        }
+    };
+
+    // Rows per group so that a group holds about 'bytes' of scanlines
+    int rowsFor(size_t bytes, size_t scanlineBytes)
+    {
+        return static_cast<int>(std::max<size_t>(1, bytes / scanlineBytes));
+    }
+
+    // zlib stream of stored blocks, for PngEffort::Store and builds without zlib
+    bool writeStored(IOutputSink& sink, const uint32_t* pixels, int width, int height, const PngOptions& options)
+    {
+        const size_t MaxBlock = 65535;
+        RowFilter filter(pixels, width, options);
+        const int groupRows = rowsFor(GroupBytes, filter.scanlineBytes());
+        std::vector<uint8_t> raw, out;
+        uint32_t adler = 1;
+
+        out.push_back(0x78);
+        out.push_back(0x01);
+        for (int y0 = 0; y0 < height; y0 += groupRows) {
+            const int y1 = std::min(height, y0 + groupRows);
+            raw.clear();
+            filter.filterRows(y0, y1, raw);
+            adler = adler32Update(adler, raw.data(), raw.size());
+
+            for (size_t pos = 0; pos < raw.size();) {
+                size_t n = std::min(MaxBlock, raw.size() - pos);
+                out.push_back(y1 == height && pos + n == raw.size() ? 1 : 0);
+                out.push_back(static_cast<uint8_t>(n));
+                out.push_back(static_cast<uint8_t>(n >> 8));
+                out.push_back(static_cast<uint8_t>(~n));
+                out.push_back(static_cast<uint8_t>(~n >> 8));
+                out.insert(out.end(), raw.begin() + pos, raw.begin() + pos + n);
+                pos += n;
+            }
+            if (y1 == height) {
+                uint8_t trailer[4];
+                putBigEndian(trailer, adler);
+                out.insert(out.end(), trailer, trailer + 4);
+            }
+            if (!writeChunk(sink, "IDAT", out.data(), out.size()))
+                return false;
+            out.clear();
+        }
+        return true;
+    }
+
+#ifdef SVGREADER_HAVE_ZLIB
+    struct DeflateParameters {
+        int level, memLevel, strategy;
+        uint8_t headerFlags; // Second byte of the zlib header, with the matching FLEVEL
+    };
+
+    DeflateParameters deflateParameters(PngEffort effort)
+    {
+        switch (effort) {
+        case PngEffort::Fast:
+            return { 1, 8, Z_DEFAULT_STRATEGY, 0x01 };
+        case PngEffort::Max:
+            return { 9, 9, Z_FILTERED, 0xDA };
+        default:
+            return { 6, 8, Z_FILTERED, 0x9C };
+        }
+    }
+
+    // One zlib stream over all rows, written out as it fills the output buffer
+    bool writeDeflated(IOutputSink& sink, const uint32_t* pixels, int width, int height, const PngOptions& options)
+    {
+        const DeflateParameters params = deflateParameters(options.effort);
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, params.level, Z_DEFLATED, 15, params.memLevel, params.strategy) != Z_OK)
+            return false;
+
+        RowFilter filter(pixels, width, options);
+        const int groupRows = rowsFor(GroupBytes, filter.scanlineBytes());
+        std::vector<uint8_t> raw, out(GroupBytes);
+        bool ok = true;
+        for (int y0 = 0; ok && y0 < height; y0 += groupRows) {
+            const int y1 = std::min(height, y0 + groupRows);
+            raw.clear();
+            filter.filterRows(y0, y1, raw);
+
+            stream.next_in = raw.data();
+            stream.avail_in = static_cast<uInt>(raw.size());
+            const int flush = y1 == height ? Z_FINISH : Z_NO_FLUSH;
+            int status;
+            do {
+                stream.next_out = out.data();
+                stream.avail_out = static_cast<uInt>(out.size());
+                status = deflate(&stream, flush);
+                size_t produced = out.size() - stream.avail_out;
+                if (status == Z_STREAM_ERROR || (produced && !writeChunk(sink, "IDAT", out.data(), produced))) {
+                    ok = false;
+                    break;
+                }
+            } while (stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+        }
+        deflateEnd(&stream);
+        return ok;
+    }
+
+    // pigz-style: runs of rows are deflated independently as raw deflate data, each primed
+    // with the window before it and ended on a byte boundary (sync flush), so that they simply
+    // concatenate. The checksums of the runs are joined with adler32_combine.
+    bool writeDeflatedParallel(IOutputSink& sink, const uint32_t* pixels, int width, int height, const PngOptions& options)
+    {
+        const DeflateParameters params = deflateParameters(options.effort);
+        const size_t scanlineBytes = static_cast<size_t>(width) * 4 + 1;
+        const int chunkRows = rowsFor(ChunkBytes, scanlineBytes);
+        const int windowRows = static_cast<int>((WindowBytes + scanlineBytes - 1) / scanlineBytes);
+        const size_t chunkCount = (static_cast<size_t>(height) + chunkRows - 1) / chunkRows;
+
+        WorkStealingPool pool(options.threads);
+        const unsigned workers = pool.threadCount();
+        struct Chunk {
+            std::vector<uint8_t> data;
+            uint32_t adler = 1;
+            size_t rawSize = 0;
+            bool ok = false;
+        };
+        struct Scratch {
+            RowFilter filter;
+            std::vector<uint8_t> raw, window;
+        };
+        std::vector<Chunk> chunks(workers);
+        std::vector<Scratch> scratch(workers, Scratch{ RowFilter(pixels, width, options), {}, {} });
+
+        auto compress = [&](size_t index, Chunk& chunk, Scratch& s) {
+            const int y0 = static_cast<int>(index) * chunkRows;
+            const int y1 = std::min(height, y0 + chunkRows);
+            const bool last = y1 == height;
+            s.raw.clear();
+            s.filter.filterRows(y0, y1, s.raw);
+            chunk.adler = adler32Update(1, s.raw.data(), s.raw.size());
+            chunk.rawSize = s.raw.size();
+            chunk.ok = false;
+
+            z_stream stream;
+            std::memset(&stream, 0, sizeof(stream));
+            if (deflateInit2(&stream, params.level, Z_DEFLATED, -15, params.memLevel, params.strategy) != Z_OK)
+                return;
+            if (y0 > 0) {
+                // The same scanlines the previous chunk ends with
+                s.window.clear();
+                s.filter.filterRows(std::max(0, y0 - windowRows), y0, s.window);
+                size_t size = std::min(WindowBytes, s.window.size());
+                deflateSetDictionary(&stream, s.window.data() + s.window.size() - size, static_cast<uInt>(size));
+            }
+
+            chunk.data.resize(deflateBound(&stream, static_cast<uLong>(s.raw.size())) + 16);
+            stream.next_in = s.raw.data();
+            stream.avail_in = static_cast<uInt>(s.raw.size());
+            stream.next_out = chunk.data.data();
+            stream.avail_out = static_cast<uInt>(chunk.data.size());
+            int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            chunk.ok = last ? status == Z_STREAM_END : (status == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+            chunk.data.resize(chunk.data.size() - stream.avail_out);
+            deflateEnd(&stream);
+        };
+
+        // Chunks are compressed a wave at a time and written in order, so memory stays bounded
+        const uint8_t header[2] = { 0x78, params.headerFlags };
+        if (!writeChunk(sink, "IDAT", header, sizeof(header)))
+            return false;
+        uint32_t adler = 1;
+        for (size_t first = 0; first < chunkCount; first += workers) {
+            const size_t count = std::min<size_t>(workers, chunkCount - first);
+            pool.run(count, [&](size_t i, unsigned worker) { compress(first + i, chunks[i], scratch[worker]); });
+            for (size_t i = 0; i < count; ++i) {
+                const Chunk& chunk = chunks[i];
+                if (!chunk.ok || !writeChunk(sink, "IDAT", chunk.data.data(), chunk.data.size()))
+                    return false;
+                adler = first + i == 0 ? chunk.adler : adler32_combine(adler, chunk.adler, static_cast<z_off_t>(chunk.rawSize));
+            }
+        }
+        uint8_t trailer[4];
+        putBigEndian(trailer, adler);
+        return writeChunk(sink, "IDAT", trailer, sizeof(trailer));
+    }
+#endif
+}
+
+bool writePng(IOutputSink& sink, const uint32_t* pixels, int width, int height, const PngOptions& options)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint8_t header[13];
+    putBigEndian(header, static_cast<uint32_t>(width));
+    putBigEndian(header + 4, static_cast<uint32_t>(height));
+    header[8] = 8;   // Bit depth
+    header[9] = 6;   // Colour type: RGBA
+    header[10] = 0;  // Deflate
+    header[11] = 0;  // Adaptive filtering
+    header[12] = 0;  // Not interlaced
+
+    if (!sink.write(reinterpret_cast<const char*>(signature), sizeof(signature))
+        || !writeChunk(sink, "IHDR", header, sizeof(header)))
+        return false;
+
+    bool ok;
+#ifdef SVGREADER_HAVE_ZLIB
+    if (options.effort == PngEffort::Store)
+        ok = writeStored(sink, pixels, width, height, options);
+    else if (options.threads != 1)
+        ok = writeDeflatedParallel(sink, pixels, width, height, options);
+    else
+        ok = writeDeflated(sink, pixels, width, height, options);
+#else
+    PngOptions stored = options;
+    stored.effort = PngEffort::Store; // Filtering does not help stored blocks
+    ok = writeStored(sink, pixels, width, height, stored);
+#endif
+    return ok && writeChunk(sink, "IEND", nullptr, 0);
+}
+
+bool savePng(const std::string& path, const uint32_t* pixels, int width, int height, const PngOptions& options)
+{
+    std::unique_ptr<FileDescriptorSink> file = FileDescriptorSink::open(path);
+    if (!file)
+        return false;
+    bool ok = writePng(*file, pixels, width, height, options);
+    return file->close() && ok;
+}
@@ -0,0 +1,31 @@
+﻿// include/PngWriter.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include "OutputSink.h"
+
+// How hard the encoder works on size. Without zlib (SVGREADER_HAVE_ZLIB) every level writes
+// stored (uncompressed) deflate blocks.
+enum class PngEffort {
+    Store,   // No filtering, no compression: fastest, largest
+    Fast,    // Sub filter on every row, zlib level 1
+    Default, // Filter chosen per row, zlib level 6
+    Max,     // Filter chosen per row, zlib level 9 with the most memory: smallest
+};
+
+struct PngOptions {
+    PngEffort effort = PngEffort::Default;
+    // Threads compressing independent runs of rows, pigz style (0: one per hardware thread).
+    // Files get slightly larger with more threads; the pixels decode the same.
+    unsigned threads = 1;
+    // false: the pixels are straight (non-premultiplied) RGBA8, as sf::Image holds them
+    bool premultiplied = true;
+};
+
+// Encodes premultiplied RGBA8 pixels (the Compositing.h layout) as an 8-bit RGBA PNG. Rows are
+// filtered, compressed and written to the sink a group at a time, without a second copy of
+// the image.
+bool writePng(IOutputSink& sink, const uint32_t* pixels, int width, int height, const PngOptions& options = PngOptions());
+
+// writePng() into a new file at 'path'
+bool savePng(const std::string& path, const uint32_t* pixels, int width, int height, const PngOptions& options = PngOptions());
@@ -0,0 +1,157 @@
+﻿// include/RasterRenderer.h
+#pragma once
+#include "IRenderer.h"
+#include "EncoderPool.h"
+#include "ImageWriter.h"
+#include "Rasteriser.h"
+#include "Stroker.h"
+#include "WorkStealingPool.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Pure-CPU renderer: anti-aliased scanline rasterisation into a premultiplied RGBA8 buffer
+// (the Compositing.h layout), saved as PNG or another ImageWriter.h format. Needs neither
+// SFML nor a GPU context.
+class RasterRenderer : public IRenderer
+{
+public:
+    // Curves are flattened until they deviate less than this many device pixels
+    static const float FlattenTolerance;
+    // Edge length of the square tiles of the tiled mode
+    static const int TileSize = 64;
+
+    RasterRenderer();
+    ~RasterRenderer() override;
+
+    // Tiled mode: draw calls are recorded, binned into tiles by their device-space bounds and
+    // rasterised tile by tile on 'threads' workers (0: one per hardware thread) when the image
+    // is read or saved. The pixels do not depend on the thread count. Gradients set with
+    // setFillGradient(const SVGGradient&) must stay alive until then.
+    void setTiledRendering(bool enabled, unsigned threads = 0);
+    // Rasterises everything recorded in tiled mode
+    void flush();
+
+    void initialize(int width, int height) override;
+    void saveToFile(const std::string& filepath) override;
+    // Copies the image and writes it on 'pool' (nullptr: EncoderPool::shared()), so
+    // drawing can go on meanwhile. Blocks while the pool's queue is full. The future is true
+    // once the file is written.
+    std::future<bool> saveToFileAsync(const std::string& filepath, EncoderPool* pool = nullptr);
+    // Effort and threads of the PNG encoder used by both saves
+    void setPngOptions(const PngOptions& options) { pngOptions = options; }
+    // Format of the files saved from now on; Auto (the default) goes by the extension and
+    // falls back to PNG
+    void setOutputFormat(ImageFormat format) { outputFormat = format; }
+
+    void drawCircle(float x, float y, float radius) override;
+    void drawSquare(float x, float y, float size) override;
+    void drawRectangle(float x, float y, float width, float height) override;
+    void drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3) override;
+    void drawEllipse(float centerX, float centerY, float radiusX, float radiusY) override;
+    void drawLine(const Point2D& p1, const Point2D& p2) override;
+    void drawPolyline(const std::vector<Point2D>& points) override;
+    void drawPolygon(const std::vector<Point2D>& points) override;
+    void drawText(float x, float y, const std::string& textContent, int fontSize, const std::string& typeface, const std::string& fontFilePath) override;
+    void drawPath(const std::vector<PathCommand>& segments, unsigned long fillColour, unsigned long strokeColour, float fillOpacity, float strokeOpacity, float strokeWidth) override;
+    void drawPath(const std::string& dStr) override;
+    void drawLinearGradient(const std::string& id, const Point2D& P1, const Point2D& P2, const std::vector<std::pair<float, std::string>>& stops) override;
+    void drawRadialGradient(const std::string& id, const Point2D& centre, float r, const std::vector<std::pair<float, std::string>>& stops) override;
+    void drawInstance(SVGElements* definition, const Transform& transform) override;
+
+    void setFillColor(int r, int g, int b, int a = 255) override;
+    void setStrokeColor(int r, int g, int b, int a = 255) override;
+    void setStrokeWidth(float width) override;
+    void setFillGradient(const std::string& gradientId) override;
+    void setStrokeGradient(const std::string& gradientId) override;
+    void setFillGradient(const SVGGradient& gradient) override;
+    void setStrokeGradient(const SVGGradient& gradient) override;
+    void setFillColor(const std::string& css) override;
+    void setStrokeColor(const std::string& css) override;
+    void setFillRule(FillRule rule) override;
+    void setStrokeStyle(const StrokeStyle& style) override;
+    void setRenderCache(RenderCache* cache) override;
+
+    void pushTransform(const std::string& transformStr) override;
+    void pushTransform(const Transform& transform) override;
+    void popTransform() override;
+    void beginGroup() override;
+    void endGroup() override;
+
+    // Premultiplied RGBA8 pixels, row by row (flushed first)
+    const std::vector<uint32_t>& getPixels() { flush(); return pixels; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    // Solid colour (premultiplied) or gradient of the fill or the stroke
+    struct Paint {
+        uint32_t colour = 0xFF000000;
+        const SVGGradient* gradient = nullptr;
+    };
+    // Closed outlines in device space, ready for the rasteriser
+    struct DevicePath {
+        std::vector<Point2D> points;
+        std::vector<size_t> contourEnds;
+        float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+
+        void clear() { points.clear(); contourEnds.clear(); }
+    };
+    // One fill or stroke recorded in tiled mode
+    struct DrawCommand {
+        DevicePath path;
+        Paint paint;
+        Transform toGradient;
+        unsigned opacity;
+        FillRule rule;
+    };
+
+    int width = 0, height = 0;
+    std::vector<uint32_t> pixels;
+    Rasteriser rasteriser;
+    PngOptions pngOptions;
+    ImageFormat outputFormat = ImageFormat::Auto;
+
+    Paint fill, stroke;
+    float strokeWidth = 1.0f;
+    FillRule fillRule = FillRule::NonZero;
+    StrokeStyle strokeStyle;
+    RenderCache* renderCache = nullptr; // Of the element being drawn, taken by the next draw call
+    std::vector<Transform> transformStack{ Transform() }; // Never empty: identity at the bottom
+    std::map<std::string, std::unique_ptr<SVGGradient>> gradients; // From drawLinear/RadialGradient
+    std::vector<Polyline> contours; // Flattened geometry in user space
+    Stroker stroker;
+    PolygonSet strokeOutline;
+    DevicePath devicePath;
+    bool warnedText = false;
+
+    std::unique_ptr<WorkStealingPool> pool; // Set in tiled mode
+    std::vector<DrawCommand> commands;
+    std::vector<Rasteriser> workerRasterisers;
+
+    const SVGGradient* findGradient(const std::string& cssOrId) const;
+    // Ratio between device and user-space lengths under the current transform
+    float deviceScale() const;
+
+    // Contours built up by the draw calls below, then filled and/or stroked
+    void beginContour(float x, float y);
+    void addPoint(float x, float y);
+    void closeContour();
+    void addEllipse(float cx, float cy, float rx, float ry);
+    // User-space bounding box of the contours (the geometry, without the stroke)
+    void contourBounds(float bounds[4]) const;
+    // Returns the cache set for this draw call and forgets it
+    RenderCache* takeRenderCache();
+
+    void fillContours(const Paint& paint, unsigned opacity);
+    // Reuses the outline in 'cache' when it was made with the same stroke parameters
+    void strokeContours(const Paint& paint, unsigned opacity, RenderCache* cache);
+    // Paints devicePath with 'paint' (or records it in tiled mode); 'userBounds' positions a gradient
+    void paintPath(const Paint& paint, unsigned opacity, FillRule rule, float userBounds[4]);
+    void addDevicePolygon(const Point2D* points, size_t count);
+    // Adds the edges of 'path' that can affect the pixels of the clip [x0, x1) x [y0, y1)
+    static void addEdgesForClip(Rasteriser& rasteriser, const DevicePath& path, int x0, int y0, int x1, int y1);
+    void renderTile(size_t tile, const std::vector<uint32_t>& commandIds, Rasteriser& rasteriser);
+};
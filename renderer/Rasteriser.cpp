@@ -0,0 +1,209 @@
+﻿// src/Rasteriser.cpp
+#include "Rasteriser.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Sub-pixel precision of span ends along x
+    const int FixedShift = 8;
+    const int FixedOne = 1 << FixedShift;
+
+    // Clamps before converting, so coordinates far outside the clip cannot overflow an int
+    int clampToRange(float value, int lo, int hi)
+    {
+        return static_cast<int>(std::min(std::max(value, static_cast<float>(lo)), static_cast<float>(hi)));
+    }
+}
+
+void Rasteriser::reset()
+{
+    edges.clear();
+    open = false;
+}
+
+void Rasteriser::setClip(int x0, int y0, int x1, int y1)
+{
+    clipX0 = x0;
+    clipY0 = y0;
+    clipX1 = std::max(x0, x1);
+    clipY1 = std::max(y0, y1);
+}
+
+void Rasteriser::moveTo(float x, float y)
+{
+    close();
+    startX = lastX = x;
+    startY = lastY = y;
+    open = true;
+}
+
+void Rasteriser::lineTo(float x, float y)
+{
+    if (!open) {
+        moveTo(x, y);
+        return;
+    }
+    addEdge(lastX, lastY, x, y);
+    lastX = x;
+    lastY = y;
+}
+
+void Rasteriser::close()
+{
+    if (open && (lastX != startX || lastY != startY))
+        addEdge(lastX, lastY, startX, startY);
+    lastX = startX;
+    lastY = startY;
+    open = false;
+}
+
+void Rasteriser::addEdge(float x0, float y0, float x1, float y1)
+{
+    if (!(std::isfinite(x0) && std::isfinite(y0) && std::isfinite(x1) && std::isfinite(y1)))
+        return;
+
+    if (edges.empty()) {
+        minX = maxX = x0;
+        minY = maxY = y0;
+    }
+    minX = std::min(minX, std::min(x0, x1));
+    maxX = std::max(maxX, std::max(x0, x1));
+    minY = std::min(minY, std::min(y0, y1));
+    maxY = std::max(maxY, std::max(y0, y1));
+
+    // Horizontal edges never cross a sub-scanline
+    if (y0 == y1)
+        return;
+
+    Edge edge;
+    edge.winding = 1;
+    if (y0 > y1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        edge.winding = -1;
+    }
+    edge.x0 = x0;
+    edge.y0 = y0;
+    edge.y1 = y1;
+    edge.slope = (x1 - x0) / (y1 - y0);
+    edges.push_back(edge);
+}
+
+void Rasteriser::bounds(float& outMinX, float& outMinY, float& outMaxX, float& outMaxY) const
+{
+    outMinX = minX;
+    outMinY = minY;
+    outMaxX = maxX;
+    outMaxY = maxY;
+}
+
+void Rasteriser::accumulateSpan(float xa, float xb)
+{
+    // Clamped to the clip in float first, so far-away geometry cannot overflow the fixed point
+    xa = std::max(xa, static_cast<float>(clipX0));
+    xb = std::min(xb, static_cast<float>(clipX1));
+    if (!(xa < xb))
+        return;
+
+    int fa = static_cast<int>(std::lround((xa - clipX0) * FixedOne));
+    int fb = static_cast<int>(std::lround((xb - clipX0) * FixedOne));
+    if (fa >= fb)
+        return;
+
+    int ia = fa >> FixedShift, ib = fb >> FixedShift;
+    if (ia == ib) {
+        area[ia] += fb - fa;
+        return;
+    }
+    area[ia] += FixedOne - (fa & (FixedOne - 1));
+    delta[ia + 1] += FixedOne;
+    delta[ib] -= FixedOne;
+    area[ib] += fb & (FixedOne - 1);
+}
+
+void Rasteriser::rasterise(FillRule rule, CoverageSink& sink)
+{
+    close();
+    if (edges.empty() || clipX0 >= clipX1 || clipY0 >= clipY1)
+        return;
+
+    // One column of slack either side absorbs rounding in the crossing positions
+    int rowStart = clampToRange(std::floor(minY), clipY0, clipY1);
+    int rowEnd = clampToRange(std::ceil(maxY), clipY0, clipY1);
+    int colStart = clampToRange(std::floor(minX) - 1.0f, clipX0, clipX1);
+    int colEnd = clampToRange(std::ceil(maxX) + 1.0f, clipX0, clipX1);
+    if (rowStart >= rowEnd || colStart >= colEnd)
+        return;
+
+    // Edge table, ordered by top y; 'next' is the first edge not yet activated
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.y0 < b.y0; });
+    size_t next = 0;
+    active.clear();
+
+    const int width = clipX1 - clipX0;
+    area.assign(width + 2, 0);
+    delta.assign(width + 2, 0);
+    coverage.resize(width);
+
+    // Full coverage of a pixel summed over all sub-scanlines
+    const int fullCoverage = FixedOne * SubSamples;
+
+    for (int y = rowStart; y < rowEnd; ++y) {
+        bool touched = false;
+        for (int s = 0; s < SubSamples; ++s) {
+            const float sampleY = y + (s + 0.5f) / SubSamples;
+
+            while (next < edges.size() && edges[next].y0 <= sampleY)
+                active.push_back(next++);
+            // Drop edges that end above this sub-scanline
+            active.erase(std::remove_if(active.begin(), active.end(),
+                [&](size_t e) { return edges[e].y1 <= sampleY; }), active.end());
+
+            crossings.clear();
+            for (size_t e : active) {
+                const Edge& edge = edges[e];
+                if (edge.y0 > sampleY)
+                    continue;
+                crossings.push_back({ edge.x0 + (sampleY - edge.y0) * edge.slope, edge.winding });
+            }
+            if (crossings.size() < 2)
+                continue;
+
+            // Crossings stay nearly sorted from one sub-scanline to the next
+            for (size_t i = 1; i < crossings.size(); ++i) {
+                Crossing c = crossings[i];
+                size_t j = i;
+                for (; j > 0 && crossings[j - 1].x > c.x; --j)
+                    crossings[j] = crossings[j - 1];
+                crossings[j] = c;
+            }
+
+            int winding = 0;
+            for (size_t i = 0; i + 1 < crossings.size(); ++i) {
+                winding += crossings[i].winding;
+                bool inside = (rule == FillRule::NonZero) ? winding != 0 : (winding & 1) != 0;
+                if (inside) {
+                    accumulateSpan(crossings[i].x, crossings[i + 1].x);
+                    touched = true;
+                }
+            }
+        }
+
+        if (!touched)
+            continue;
+
+        // Resolve the row and hand the touched columns to the sink. Spans never reach
+        // outside [first, last], which is all that needs clearing for the next row.
+        const int first = colStart - clipX0, last = colEnd - clipX0;
+        int run = 0;
+        for (int i = first; i < last; ++i) {
+            run += delta[i];
+            int value = std::min(run + area[i], fullCoverage);
+            coverage[i] = static_cast<uint8_t>((value * 255 + fullCoverage / 2) / fullCoverage);
+        }
+        std::fill(area.begin() + first, area.begin() + last + 1, 0);
+        std::fill(delta.begin() + first, delta.begin() + last + 1, 0);
+        sink.blendSpan(y, colStart, last - first, &coverage[first]);
+    }
+}
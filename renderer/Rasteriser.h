@@ -0,0 +1,71 @@
+﻿// include/Rasteriser.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FillRule.h"
+
+// Receives the anti-aliased coverage (0..255) of one row of pixels
+class CoverageSink
+{
+public:
+    virtual ~CoverageSink() = default;
+    virtual void blendSpan(int y, int x, int count, const uint8_t* coverage) = 0;
+};
+
+// Anti-aliased scanline polygon rasteriser. Contours are given in device space with
+// moveTo/lineTo/close; rasterise() walks an active edge table over SubSamples sub-scanlines
+// per pixel row and computes exact horizontal coverage within each sub-scanline.
+// A pixel's coverage depends only on the edges, never on the clip rectangle, so the same
+// path rasterised through different clips (e.g. tiles) gives identical pixels.
+class Rasteriser
+{
+public:
+    static const int SubSamples = 4;
+
+    // Drops all edges; the clip rectangle is kept
+    void reset();
+    // Pixels outside [x0, x1) x [y0, y1) are never emitted
+    void setClip(int x0, int y0, int x1, int y1);
+
+    void moveTo(float x, float y);
+    void lineTo(float x, float y);
+    // Closes the current contour back to its first point
+    void close();
+    // A single edge, outside of any contour (the caller keeps the outline closed)
+    void addLine(float x0, float y0, float x1, float y1) { addEdge(x0, y0, x1, y1); }
+
+    bool empty() const { return edges.empty(); }
+    // Device-space bounds of the edges added since reset()
+    void bounds(float& minX, float& minY, float& maxX, float& maxY) const;
+
+    void rasterise(FillRule rule, CoverageSink& sink);
+
+private:
+    struct Edge {
+        float x0, y0, y1;  // Top point and bottom y, y0 < y1
+        float slope;       // dx/dy
+        int winding;       // +1 downwards, -1 upwards
+    };
+    struct Crossing {
+        float x;
+        int winding;
+    };
+
+    std::vector<Edge> edges;
+    std::vector<size_t> active;
+    std::vector<Crossing> crossings;
+    // Per-row accumulators: 'area' holds partial pixels, 'delta' the starts and ends of
+    // fully covered runs (prefix-summed when the row is emitted)
+    std::vector<int32_t> area, delta;
+    std::vector<uint8_t> coverage;
+
+    int clipX0 = 0, clipY0 = 0, clipX1 = 0, clipY1 = 0;
+    float startX = 0.0f, startY = 0.0f, lastX = 0.0f, lastY = 0.0f;
+    float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+    bool open = false;
+
+    void addEdge(float x0, float y0, float x1, float y1);
+    // Adds the horizontal span [xa, xb) of one sub-scanline to the row accumulators
+    void accumulateSpan(float xa, float xb);
+};
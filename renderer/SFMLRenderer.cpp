@@ -1,23 +1,67 @@
 ﻿// src/SFMLRenderer.cpp
 #include "SFMLRenderer.h"
+#include "Gradient.h"
+#include "UnitCircle.h"
+#include "ColorUtils.h"
+#include "Diagnostics.h"
 #include <cmath>
+#include <algorithm>
 #include <math.h>
 #include <stack>
 #include <iostream>
 #include <sstream>
 #include <vector>
 #include <filesystem>
-#include <set>
 #include <map>
 #include <SFML/Graphics.hpp>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+namespace
+{
+    // Curves, ellipses, round joins and caps stay within this many device pixels of the exact shape
+    const float FlattenTolerance = 0.25f;
+
+    sf::Color toSfColour(unsigned long rgba, float opacity)
+    {
+        float alpha = (rgba & 0xFF) * std::min(std::max(opacity, 0.0f), 1.0f);
+        return sf::Color((rgba >> 24) & 0xFF, (rgba >> 16) & 0xFF, (rgba >> 8) & 0xFF, static_cast<sf::Uint8>(alpha + 0.5f));
+    }
+
+    // FlattenTolerance in the user space of 'transform'
+    float userTolerance(const sf::Transform& transform)
+    {
+        const float* m = transform.getMatrix();
+        float scale = std::sqrt(std::fabs(m[0] * m[5] - m[1] * m[4]));
+        return FlattenTolerance / (scale > 1e-6f ? scale : 1.0f);
+    }
+
+    // Formats of ImageWriter.h go through the built-in writers, which take sf::Image's straight
+    // RGBA8 (R first in memory) as is; other extensions are left to SFML
+    bool writeImageFile(const sf::Image& image, const std::string& path, ImageFormat format, PngOptions options)
+    {
+        if (format == ImageFormat::Auto && !imageFormatForPath(path, format))
+            return image.saveToFile(path);
+        options.premultiplied = false;
+        const sf::Vector2u size = image.getSize();
+        return saveImage(path, format, reinterpret_cast<const uint32_t*>(image.getPixelsPtr()), static_cast<int>(size.x), static_cast<int>(size.y), options);
+    }
+
+    void setStops(SVGGradient& gradient, const std::vector<std::pair<float, std::string>>& stops)
+    {
+        float last = 0.0f;
+        for (const auto& stop : stops) {
+            last = std::max(last, std::min(std::max(stop.first, 0.0f), 1.0f));
+            gradient.stops.push_back({ last, parseColorString(stop.second) });
+        }
+        gradient.finalize();
+    }
+}
 
-std::stack<sf::Transform> sfmlTransformStack{ {sf::Transform()} }; // identity transform
+SFMLRenderer::SFMLRenderer(std::shared_ptr<FontCache> fonts)
+    : fontCache(fonts ? fonts : FontCache::shared())
+{
+}
 
-static std::map<std::string, sf::Font> fontCache;
+SFMLRenderer::~SFMLRenderer() = default; // Here, where SVGGradient is a complete type
 
 void SFMLRenderer::initialize(int width, int height) {
     renderTexture.create(width, height);
@@ -25,6 +69,13 @@ void SFMLRenderer::initialize(int width, int height) {
     fillColor = sf::Color::Black;
     strokeColor = sf::Color::Black;
     strokeWidth = 1.0f;
+    fillRule = FillRule::NonZero;
+    strokeStyle = StrokeStyle();
+    renderCache = nullptr;
+    fillGradient = nullptr;
+    batch.clear();
+    drawCalls = 0;
+    transformStack.assign(1, sf::Transform());
     renderTexture.display();
 
 }
@@ -38,20 +89,14 @@ void SFMLRenderer::drawSquare(float x, float y, float size)
 {
     sf::RectangleShape square(sf::Vector2f(size, size));
     square.setPosition(x, y);
-    square.setFillColor(fillColor);
-    square.setOutlineColor(strokeColor);
-    square.setOutlineThickness(strokeWidth);
-    renderTexture.draw(square);
+    drawShape(square);
 }
 
 void SFMLRenderer::drawRectangle(float x, float y, float width, float height)
 {
     sf::RectangleShape rect(sf::Vector2f(width, height));
     rect.setPosition(x, y);
-    rect.setFillColor(fillColor);
-    rect.setOutlineColor(strokeColor);
-    rect.setOutlineThickness(strokeWidth);
-    renderTexture.draw(rect);
+    drawShape(rect);
 }
 
 void SFMLRenderer::drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
@@ -61,10 +106,7 @@ void SFMLRenderer::drawTriangle(float x1, float y1, float x2, float y2, float x3
     triangle.setPoint(0, sf::Vector2f(x1, y1));
     triangle.setPoint(1, sf::Vector2f(x2, y2));
     triangle.setPoint(2, sf::Vector2f(x3, y3));
-    triangle.setFillColor(fillColor);
-    triangle.setOutlineColor(strokeColor);
-    triangle.setOutlineThickness(strokeWidth);
-    renderTexture.draw(triangle);
+    drawShape(triangle);
 }
 
 void SFMLRenderer::drawEllipse(float centerX, float centerY, float radiusX, float radiusY)
@@ -74,121 +116,246 @@ void SFMLRenderer::drawEllipse(float centerX, float centerY, float radiusX, floa
 
 void SFMLRenderer::drawLine(const Point2D& p1, const Point2D& p2)
 {
-    sf::Vertex line[] =
-    {
-        sf::Vertex(sf::Vector2f(p1.x, p1.y), strokeColor),
-        sf::Vertex(sf::Vector2f(p2.x, p2.y), strokeColor)
-    };
-    renderTexture.draw(line, 2, sf::Lines);
+    RenderCache* cache = takeRenderCache();
+    Polyline& line = resetContours(false);
+    line.points.push_back(p1);
+    line.points.push_back(p2);
+    drawStroke(strokeColor, strokeWidth, cache, transformStack.back());
 }
 
-void SFMLRenderer::drawEllipseShape(float centerX, float centerY, float radiusX, float radiusY)
+RenderCache* SFMLRenderer::takeRenderCache()
 {
-    // SFML không có ellipse shape mặc định nên phải tạo xấp xỉ
-    const int pointCount = 30;
-    sf::ConvexShape ellipse;
-    ellipse.setPointCount(pointCount);
+    RenderCache* cache = renderCache;
+    renderCache = nullptr;
+    return cache;
+}
 
-    for (int i = 0; i < pointCount; ++i)
-    {
-        float angle = 2 * M_PI * i / pointCount;
-        float x = centerX + radiusX * cos(angle);
-        float y = centerY + radiusY * sin(angle);
-        ellipse.setPoint(i, sf::Vector2f(x, y));
+void SFMLRenderer::drawStroke(const sf::Color& colour, float width, RenderCache* cache, const sf::Transform& transform)
+{
+    if (width <= 0.0f || colour.a == 0)
+        return;
+
+    const float tolerance = userTolerance(transform);
+
+    std::shared_ptr<const PolygonSet> cached;
+    if (cache)
+        cached = cache->findStroke(strokeStyle, width, tolerance);
+    const PolygonSet* outline = cached.get();
+    if (!outline) {
+        stroker.setStyle(strokeStyle, width);
+        stroker.setTolerance(tolerance);
+        strokeOutline.clear();
+        for (const Polyline& contour : contours)
+            stroker.stroke(contour, strokeOutline);
+        if (cache)
+            cache->storeStroke(std::make_shared<PolygonSet>(strokeOutline), strokeStyle, width, tolerance);
+        outline = &strokeOutline;
+    }
+
+    // Every piece is convex, so a fan from its first point covers it
+    uint32_t begin = 0;
+    for (uint32_t end : outline->ends) {
+        for (uint32_t i = begin + 1; i + 1 < end; ++i) {
+            addToBatch(outline->points[begin], colour, transform);
+            addToBatch(outline->points[i], colour, transform);
+            addToBatch(outline->points[i + 1], colour, transform);
+        }
+        begin = end;
+    }
+    if (!batching)
+        flush();
+}
+
+void SFMLRenderer::addToBatch(const Point2D& point, const sf::Color& colour, const sf::Transform& transform)
+{
+    // Whole triangles only, so the batch can be drawn between any two of them
+    if (batch.getVertexCount() >= MaxBatchVertices && batch.getVertexCount() % 3 == 0)
+        flush();
+    batch.append(sf::Vertex(transform.transformPoint(point.x, point.y), colour));
+}
+
+void SFMLRenderer::flush()
+{
+    if (batch.getVertexCount() == 0)
+        return;
+    renderTexture.draw(batch);
+    ++drawCalls;
+    batch.clear();
+}
+
+void SFMLRenderer::drawShape(sf::Shape& shape)
+{
+    RenderCache* cache = takeRenderCache();
+    Polyline& outline = resetContours(true);
+    for (size_t i = 0; i < shape.getPointCount(); ++i) {
+        sf::Vector2f p = shape.getTransform().transformPoint(shape.getPoint(i));
+        outline.points.push_back(Point2D(p.x, p.y));
+    }
+    drawContours(cache);
+}
+
+void SFMLRenderer::drawContours(RenderCache* cache)
+{
+    drawFill(fillColor, fillGradient, cache, transformStack.back());
+    // The stroke is not textured: it keeps its solid colour
+    drawStroke(strokeColor, strokeWidth, cache, transformStack.back());
+}
+
+void SFMLRenderer::drawFill(const sf::Color& colour, const SVGGradient* gradient, RenderCache* cache, const sf::Transform& transform)
+{
+    if (!gradient && colour.a == 0)
+        return;
+
+    const float tolerance = userTolerance(transform);
+    std::shared_ptr<const TriangleMesh> cached;
+    if (cache)
+        cached = cache->findFill(fillRule, tolerance);
+    const TriangleMesh* mesh = cached.get();
+    if (!mesh) {
+        fillMesh.clear();
+        triangulator.triangulate(contours, fillRule, fillMesh);
+        if (cache)
+            cache->storeFill(std::make_shared<TriangleMesh>(fillMesh), fillRule, tolerance);
+        mesh = &fillMesh;
+    }
+    if (mesh->empty())
+        return;
+
+    if (!gradient) {
+        for (uint32_t index : mesh->indices)
+            addToBatch(mesh->vertices[index], colour, transform);
+        if (!batching)
+            flush();
+        return;
+    }
+
+    // Shade the bounding box one row span at a time through the gradient's colour ramp
+    float minX = mesh->vertices[0].x, minY = mesh->vertices[0].y, maxX = minX, maxY = minY;
+    for (const Point2D& p : mesh->vertices) {
+        minX = std::min(minX, p.x);
+        minY = std::min(minY, p.y);
+        maxX = std::max(maxX, p.x);
+        maxY = std::max(maxY, p.y);
     }
+    const float boundsWidth = maxX - minX, boundsHeight = maxY - minY;
+    unsigned w = std::max(1u, static_cast<unsigned>(std::ceil(boundsWidth)));
+    unsigned h = std::max(1u, static_cast<unsigned>(std::ceil(boundsHeight)));
+    Transform texelToGradient = gradient->gradientSpace(minX, minY, boundsWidth, boundsHeight)
+        * Transform::translate(minX, minY)
+        * Transform::scale(boundsWidth / w, boundsHeight / h);
 
-    ellipse.setFillColor(fillColor);
-    ellipse.setOutlineColor(strokeColor);
-    ellipse.setOutlineThickness(strokeWidth);
-    renderTexture.draw(ellipse);
+    std::vector<uint32_t> pixels(static_cast<size_t>(w) * h);
+    for (unsigned row = 0; row < h; ++row)
+        gradient->shadeSpan(texelToGradient, 0.5f, row + 0.5f, w, &pixels[static_cast<size_t>(row) * w]);
+
+    // What is batched lies underneath this fill
+    flush();
+    gradientTexture.create(w, h);
+    gradientTexture.update(reinterpret_cast<const sf::Uint8*>(pixels.data()));
+
+    fillTriangles.clear();
+    const float texelsX = boundsWidth > 0.0f ? w / boundsWidth : 0.0f;
+    const float texelsY = boundsHeight > 0.0f ? h / boundsHeight : 0.0f;
+    for (uint32_t index : mesh->indices) {
+        const Point2D& p = mesh->vertices[index];
+        fillTriangles.append(sf::Vertex(sf::Vector2f(p.x, p.y), sf::Color::White,
+            sf::Vector2f((p.x - minX) * texelsX, (p.y - minY) * texelsY)));
+    }
+
+    // The colour ramp is premultiplied
+    sf::RenderStates textured(transform);
+    textured.texture = &gradientTexture;
+    textured.blendMode = sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha);
+    renderTexture.draw(fillTriangles, textured);
+    ++drawCalls;
+}
+
+void SFMLRenderer::drawEllipseShape(float centerX, float centerY, float radiusX, float radiusY)
+{
+    RenderCache* cache = takeRenderCache();
+    if (radiusX <= 0.0f || radiusY <= 0.0f)
+        return;
+
+    // As many segments as the size on screen needs, from the shared table
+    const int segments = ellipseSegmentCount(std::max(radiusX, radiusY), userTolerance(transformStack.back()));
+    Polyline& outline = resetContours(true);
+    for (const Point2D& p : unitCircle(segments))
+        outline.points.push_back(Point2D(centerX + radiusX * p.x, centerY + radiusY * p.y));
+    drawContours(cache);
+}
+
+Polyline& SFMLRenderer::resetContours(bool closed)
+{
+    // The point buffer of the first contour is kept from call to call
+    contours.resize(1);
+    contours[0].points.clear();
+    contours[0].closed = closed;
+    return contours[0];
 }
 
 void SFMLRenderer::drawPolyline(const std::vector<Point2D>& points)
 {
+    RenderCache* cache = takeRenderCache();
     if (points.size() < 2) return;
 
-    sf::VertexArray polyline(sf::LinesStrip, points.size());
-    for (size_t i = 0; i < points.size(); ++i) {
-        polyline[i].position = sf::Vector2f(points[i].x, points[i].y);
-        polyline[i].color = strokeColor;
-    }
-    renderTexture.draw(polyline);
+    resetContours(false).points = points;
+    drawStroke(strokeColor, strokeWidth, cache, transformStack.back());
 }
 
 void SFMLRenderer::drawPolygon(const std::vector<Point2D>& points)
 {
+    RenderCache* cache = takeRenderCache();
     if (points.size() < 3) return;
 
-    sf::ConvexShape polygon;
-    polygon.setPointCount(points.size());
-    for (size_t i = 0; i < points.size(); ++i) {
-        polygon.setPoint(i, sf::Vector2f(points[i].x, points[i].y));
-    }
-    polygon.setFillColor(fillColor);
-    polygon.setOutlineColor(strokeColor);
-    polygon.setOutlineThickness(strokeWidth);
-    renderTexture.draw(polygon);
+    resetContours(true).points = points;
+    drawContours(cache);
 }
 
 void SFMLRenderer::drawText(float x, float y, const std::string& textContent, int fontSize, const std::string& typeface, const std::string& fontFilePath)
 {
-    auto& font = fontCache[fontFilePath];
-    static std::set<std::string> loadedFonts;
-
-    if (!loadedFonts.count(fontFilePath)) {
-        if (!font.loadFromFile(fontFilePath)) {
-            return;
-        }
-        loadedFonts.insert(fontFilePath);
+    takeRenderCache();
+    const sf::Font* font = getFont(fontFilePath);
+    if (!font) {
+        return;
     }
 
-
     sf::Text text;
-    text.setFont(font);
+    text.setFont(*font);
     text.setString(textContent);
     text.setCharacterSize(fontSize);
     text.setFillColor(fillColor);
     text.setOutlineColor(strokeColor);
     text.setOutlineThickness(strokeWidth);
     text.setPosition(x, y);
+    flush();
     renderTexture.draw(text);
+    ++drawCalls;
 }
 
-void SFMLRenderer::drawPath(const std::vector<PathCommand>& segments, unsigned long fillColour, unsigned long strokeColour, float fillOpacity, float strokeOpacity, float strokeWidth)
+const sf::Font* SFMLRenderer::getFont(const std::string& fontFilePath)
 {
-    sf::VertexArray path(sf::LineStrip);
-    Point2D current;
-
-    for (const auto& cmd : segments) {
-        switch (cmd.type) {
-        case PathCommandType::MoveTo:
-            current = cmd.points[0];
-            if (path.getVertexCount() > 0) {
-                renderTexture.draw(path, sf::RenderStates(sfmlTransformStack.top()));
-            }
-            path.append(sf::Vertex({ current.x, current.y }));
-            break;
-        case PathCommandType::LineTo:
-            for (const auto& pt : cmd.points) {
-                current = pt;
-                path.append(sf::Vertex({ current.x, current.y }));
-            }
-            break;
-        case PathCommandType::ClosePath:
-            if (path.getVertexCount() > 0)
-                path.append(path[0]);
-            break;
-        default:
-            break;
-        }
-    }
-    if (path.getVertexCount() > 0) {
-        renderTexture.draw(path, sf::RenderStates(sfmlTransformStack.top()));
+    std::unique_ptr<LoadedFont>& entry = fonts[fontFilePath];
+    if (!entry) {
+        entry.reset(new LoadedFont());
+        entry->data = fontCache->get(fontFilePath);
+        entry->ok = entry->data && entry->font.loadFromMemory(entry->data->data(), entry->data->size());
     }
+    return entry->ok ? &entry->font : nullptr;
+}
+
+void SFMLRenderer::drawPath(const std::vector<PathCommand>& segments, unsigned long fillColour, unsigned long strokeColour, float fillOpacity, float strokeOpacity, float strokeWidth)
+{
+    RenderCache* cache = takeRenderCache();
+    const sf::Transform& transform = transformStack.back();
+    contours.clear();
+    flattenPath(segments, userTolerance(transform), contours);
+    drawFill(toSfColour(fillColour, fillOpacity), fillGradient, cache, transform);
+    drawStroke(toSfColour(strokeColour, strokeOpacity), strokeWidth, cache, transform);
 }
 
 void SFMLRenderer::setFillColor(int r, int g, int b, int a) {
     fillColor = sf::Color(r, g, b, a);
+    fillGradient = nullptr;
 }
 void SFMLRenderer::setStrokeColor(int r, int g, int b, int a) {
     strokeColor = sf::Color(r, g, b, a);
@@ -197,32 +364,143 @@ void SFMLRenderer::setStrokeWidth(float width) {
     strokeWidth = width;
 }
 
+void SFMLRenderer::setFillRule(FillRule rule) {
+    fillRule = rule;
+}
+void SFMLRenderer::setStrokeStyle(const StrokeStyle& style) {
+    strokeStyle = style;
+}
+void SFMLRenderer::setRenderCache(RenderCache* cache) {
+    renderCache = cache;
+}
+
+void SFMLRenderer::setFillGradient(const SVGGradient& gradient) {
+    fillGradient = &gradient;
+}
+
+void SFMLRenderer::setStrokeGradient(const SVGGradient&) {
+    // Outlines are untextured in SFML: the stroke keeps its fallback colour
+}
+
+const SVGGradient* SFMLRenderer::findGradient(const std::string& cssOrId) const
+{
+    std::string id = cssOrId;
+    if (id.compare(0, 4, "url(") == 0) {
+        size_t end = id.find(')');
+        id = id.substr(4, end == std::string::npos ? std::string::npos : end - 4);
+    }
+    if (!id.empty() && id[0] == '#')
+        id.erase(0, 1);
+
+    auto it = gradients.find(id);
+    return it == gradients.end() ? nullptr : it->second.get();
+}
+
+void SFMLRenderer::replaceGradient(const std::string& id, std::unique_ptr<SVGGradient> gradient)
+{
+    // A fill set from the old definition takes the new one
+    const SVGGradient* old = findGradient(id);
+    if (old && fillGradient == old)
+        fillGradient = gradient.get();
+    gradients[id] = std::move(gradient);
+}
+
+void SFMLRenderer::drawLinearGradient(const std::string& id, const Point2D& P1, const Point2D& P2, const std::vector<std::pair<float, std::string>>& stops)
+{
+    // Coordinates are percentages of the bounding box, as SVGRenderer writes them
+    std::unique_ptr<SVGLinearGradient> gradient(new SVGLinearGradient());
+    gradient->p1 = Point2D(P1.x / 100.0f, P1.y / 100.0f);
+    gradient->p2 = Point2D(P2.x / 100.0f, P2.y / 100.0f);
+    setStops(*gradient, stops);
+    replaceGradient(id, std::move(gradient));
+}
+
+void SFMLRenderer::drawRadialGradient(const std::string& id, const Point2D& centre, float r, const std::vector<std::pair<float, std::string>>& stops)
+{
+    std::unique_ptr<SVGRadialGradient> gradient(new SVGRadialGradient());
+    gradient->centre = gradient->focal = Point2D(centre.x / 100.0f, centre.y / 100.0f);
+    gradient->radius = r / 100.0f;
+    setStops(*gradient, stops);
+    replaceGradient(id, std::move(gradient));
+}
+
+void SFMLRenderer::setFillGradient(const std::string& gradientId) {
+    if (const SVGGradient* gradient = findGradient(gradientId))
+        fillGradient = gradient;
+    else
+        SVG_WARN("SFMLRenderer: Fill references undefined gradient: #" << gradientId);
+}
+
+void SFMLRenderer::setStrokeGradient(const std::string&) {
+    // Outlines are untextured in SFML: the stroke keeps its fallback colour
+}
+
+void SFMLRenderer::setFillColor(const std::string& css) {
+    if (css.compare(0, 4, "url(") == 0) {
+        setFillGradient(css);
+        return;
+    }
+    fillColor = toSfColour(parseColorString(css), 1.0f);
+    fillGradient = nullptr;
+}
+
+void SFMLRenderer::setStrokeColor(const std::string& css) {
+    if (css.compare(0, 4, "url(") == 0)
+        return; // Untextured outline, as in setStrokeGradient()
+    strokeColor = toSfColour(parseColorString(css), 1.0f);
+}
+
 void SFMLRenderer::drawPath(const std::string& dStr)
 {
     SVGPath path(dStr);
+    path.fillRule = fillRule;
+    path.strokeStyle = strokeStyle;
     path.render(this);
 }
 
 void SFMLRenderer::saveToFile(const std::string &filepath) {
+    flush();
     sf::Texture texture = renderTexture.getTexture();
     sf::Image image = texture.copyToImage();
-    if (!image.saveToFile(filepath)) {
+    if (!writeImageFile(image, filepath, outputFormat, pngOptions)) {
         throw std::runtime_error("Failed to save image to file: " + filepath);
     }
 }
 
+std::future<bool> SFMLRenderer::saveToFileAsync(const std::string& filepath, EncoderPool* pool) {
+    flush();
+    // The read-back needs this thread's GL context; encoding does not
+    sf::Image image = renderTexture.getTexture().copyToImage();
+    return (pool ? *pool : *EncoderPool::shared()).submit([filepath, format = outputFormat, options = pngOptions, image = std::move(image)]() {
+        if (!writeImageFile(image, filepath, format, options)) {
+            throw std::runtime_error("Failed to save image to file: " + filepath);
+        }
+        return true;
+    });
+}
+
+void SFMLRenderer::drawInstance(SVGElements* definition, const Transform& transform) {
+    // The definition is shared by every instance; only the transform differs
+    pushTransform(transform);
+    definition->render(this);
+    popTransform();
+}
+
 void SFMLRenderer::pushTransform(const string& transformStr) {
-    Transform parsed = Transform::fromString(transformStr);
-    auto m = parsed.getMatrix();
+    pushTransform(Transform::fromString(transformStr));
+}
+
+void SFMLRenderer::pushTransform(const Transform& transform) {
+    auto m = transform.getMatrix();
     sf::Transform t(m[0], m[1], m[2],
         m[3], m[4], m[5],
         m[6], m[7], m[8]);
-    sfmlTransformStack.push(sfmlTransformStack.top() * t);
+    transformStack.push_back(transformStack.back() * t);
 }
 
 void SFMLRenderer::popTransform() {
-    if (sfmlTransformStack.size() > 1)
-        sfmlTransformStack.pop();
+    if (transformStack.size() > 1)
+        transformStack.pop_back();
 }
 
 void SFMLRenderer::beginGroup() {}
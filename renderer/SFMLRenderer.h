@@ -1,13 +1,34 @@
 ﻿// include/SFMLRenderer.h
 #pragma once
 #include "IRenderer.h"
+#include "EncoderPool.h"
+#include "FontCache.h"
+#include "ImageWriter.h"
+#include "Stroker.h"
+#include "Triangulator.h"
 #include <SFML/Graphics.hpp>
+#include <map>
+#include <memory>
+#include <vector>
 
 class SFMLRenderer : public IRenderer
 {
 public:
+    // Font files come from 'fonts', which may be shared with renderers on other threads
+    explicit SFMLRenderer(std::shared_ptr<FontCache> fonts = FontCache::shared());
+    ~SFMLRenderer() override;
+
     void initialize(int width, int height) override;
     void saveToFile(const std::string &filepath) override;
+    // Reads the image back on this thread, then encodes and writes it on 'pool' (nullptr:
+    // EncoderPool::shared()), so the next document can be drawn meanwhile. Blocks while the
+    // pool's queue is full. The future throws like saveToFile() when the file cannot be written.
+    std::future<bool> saveToFileAsync(const std::string& filepath, EncoderPool* pool = nullptr);
+    // Encoder settings for .png files, which use the built-in PNG writer like the other
+    // ImageWriter.h formats; the rest (.jpg, .bmp...) go through sf::Image
+    void setPngOptions(const PngOptions& options) { pngOptions = options; }
+    // Format of the files saved from now on; Auto (the default) goes by the extension
+    void setOutputFormat(ImageFormat format) { outputFormat = format; }
 
     void drawCircle(float x, float y, float radius) override;
     void drawSquare(float x, float y, float size) override;
@@ -19,22 +40,91 @@ public:
     void drawPolygon(const std::vector<Point2D>& points) override;
     void drawText(float x, float y, const std::string& textContent, int fontSize, const std::string& typeface, const std::string& fontFilePath) override;
     void drawPath(const std::vector<PathCommand>& segments, unsigned long fillColour, unsigned long strokeColour, float fillOpacity, float strokeOpacity, float strokeWidth) override;
+    void drawLinearGradient(const std::string& id, const Point2D& P1, const Point2D& P2, const std::vector<std::pair<float, std::string>>& stops) override;
+    void drawRadialGradient(const std::string& id, const Point2D& centre, float r, const std::vector<std::pair<float, std::string>>& stops) override;
+    void drawInstance(SVGElements* definition, const Transform& transform) override;
     void pushTransform(const string& transformStr) override;
+    void pushTransform(const Transform& transform) override;
     void popTransform() override;
     void beginGroup() override;
     void endGroup() override;
     void setFillColor(int r, int g, int b, int a = 255) override;
     void setStrokeColor(int r, int g, int b, int a = 255) override;
     void setStrokeWidth(float width) override;
+    void setFillRule(FillRule rule) override;
+    void setStrokeStyle(const StrokeStyle& style) override;
+    void setRenderCache(RenderCache* cache) override;
+    void setFillGradient(const SVGGradient& gradient) override;
+    void setStrokeGradient(const SVGGradient& gradient) override;
+    void setFillGradient(const std::string& gradientId) override;
+    void setStrokeGradient(const std::string& gradientId) override;
+    void setFillColor(const std::string& css) override;
+    void setStrokeColor(const std::string& css) override;
     void drawPath(const std::string& dStr) override;
 
+    // Draws what is still batched. Called by saveToFile(); needed before reading the texture.
+    void flush();
+    // renderTexture.draw calls since initialize()
+    unsigned getDrawCallCount() const { return drawCalls; }
+    // Off: every fill and stroke is drawn on its own, one call each as before batching, for
+    // comparing draw-call counts. On by default.
+    void setBatching(bool enabled) { flush(); batching = enabled; }
 
 private:
     sf::RenderTexture renderTexture;
+    PngOptions pngOptions;
+    ImageFormat outputFormat = ImageFormat::Auto;
     sf::Color fillColor;
     sf::Color strokeColor;
-    sf::Font font;
-    float strokeWidth;
+    float strokeWidth = 1.0f;
+    FillRule fillRule = FillRule::NonZero;
+    StrokeStyle strokeStyle;
+    RenderCache* renderCache = nullptr; // Of the element being drawn, taken by the next draw call
+    std::vector<sf::Transform> transformStack{ sf::Transform() }; // Never empty: identity at the bottom
+
+    // Fonts of this renderer, built over the shared file data (sf::Font is not safe to share)
+    struct LoadedFont {
+        std::shared_ptr<const FontCache::FontData> data; // Must outlive 'font'
+        sf::Font font;
+        bool ok = false;
+    };
+    std::shared_ptr<FontCache> fontCache;
+    std::map<std::string, std::unique_ptr<LoadedFont>> fonts;
+    const sf::Font* getFont(const std::string& fontFilePath);
+    const SVGGradient* fillGradient = nullptr;
+    std::map<std::string, std::unique_ptr<SVGGradient>> gradients; // From drawLinear/RadialGradient
+    const SVGGradient* findGradient(const std::string& cssOrId) const;
+    void replaceGradient(const std::string& id, std::unique_ptr<SVGGradient> gradient);
+    sf::Texture gradientTexture; // Fill of the shape being drawn, shaded from the gradient's colour ramp
+
+    // Fills and strokes are tessellated into triangles: sf::ConvexShape only fills convex
+    // outlines, and SFML outlines have neither caps, joins nor dashes
+    std::vector<Polyline> contours; // Geometry of the draw call
+    Triangulator triangulator;
+    TriangleMesh fillMesh;
+    sf::VertexArray fillTriangles{ sf::Triangles }; // Gradient fill, which is textured
+    Stroker stroker;
+    PolygonSet strokeOutline;
+
+    // Untextured triangles with alpha blending, already transformed, waiting to be drawn in
+    // one call. Textured fills and text are drawn directly, after flushing the batch.
+    static const size_t MaxBatchVertices = 1 << 18;
+    sf::VertexArray batch{ sf::Triangles };
+    unsigned drawCalls = 0;
+    bool batching = true;
+    void addToBatch(const Point2D& point, const sf::Color& colour, const sf::Transform& transform);
 
+    RenderCache* takeRenderCache();
+    // Leaves 'contours' with one empty contour and returns it
+    Polyline& resetContours(bool closed);
+    // Draws a shape with the current fill (colour or gradient) and outline
+    void drawShape(sf::Shape& shape);
+    // Fills and strokes 'contours' with the current paint
+    void drawContours(RenderCache* cache);
+    // Fills 'contours' (reusing the triangles in 'cache' when they match) with 'colour' or,
+    // if set, 'gradient'
+    void drawFill(const sf::Color& colour, const SVGGradient* gradient, RenderCache* cache, const sf::Transform& transform);
+    // Strokes 'contours' (reusing the outline in 'cache' when it matches) in 'colour'
+    void drawStroke(const sf::Color& colour, float width, RenderCache* cache, const sf::Transform& transform);
     void drawEllipseShape(float centerX, float centerY, float radiusX, float radiusY);
 };
\ No newline at end of file
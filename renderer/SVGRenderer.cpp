@@ -1,133 +1,605 @@
 ﻿// src/SVGRenderer.cpp
 #include "SVGRenderer.h"
 #include "ColorUtils.h"
-#include <fstream>
+#include "Gradient.h"
 #include <iomanip>
 #include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include "Diagnostics.h"
 
-void SVGRenderer::initialize(int width, int height)
+namespace
 {
-    svgContent.str("");
-    svgContent.clear();
-    defsEmitted = false;
+    // Two unrelated 64-bit hashes of the geometry of a shape: the key of the reuse table and a
+    // check that tells colliding keys apart without keeping the geometry itself
+    uint64_t fnv1a(const string& text)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (unsigned char c : text)
+            hash = (hash ^ c) * 0x100000001B3ull;
+        return hash;
+    }
+
+    uint64_t polynomialHash(const string& text)
+    {
+        uint64_t hash = 0;
+        for (unsigned char c : text)
+            hash = hash * 0x9E3779B97F4A7C15ull + c + 1;
+        return hash;
+    }
+}
 
-    svgContent << R"(<?xml version="1.0" encoding="UTF-8" standalone="no"?>)" << "\n"
-        << R"(<svg width=")" << width
-        << R"(" height=")" << height
-        << R"(" xmlns="http://www.w3.org/2000/svg">)" << "\n";
+void SVGRenderer::initialize(int width, int height)
+{
+    svgContent.flush();
+    bodySink.clear();
+    defsContent.flush();
+    defsSink.clear();
+    documentSink.clear();
+    gradientIds.clear();
+    instanceIds.clear();
+    gradientDefs.clear();
+    styleClassIds.clear();
+    styleContent.clear();
+    geometrySymbols.clear();
+    writtenIds.clear();
+    generatedIdCount = 0;
+    groupOpenStack = std::stack<bool>();
+
+    headerContent = minify ? std::string() : std::string(R"(<?xml version="1.0" encoding="UTF-8" standalone="no"?>)") + "\n";
+    headerContent += R"(<svg width=")" + std::to_string(width)
+        + R"(" height=")" + std::to_string(height)
+        + R"(" xmlns="http://www.w3.org/2000/svg">)" + newline;
+
+    // A streamed body follows the header directly; its defs are appended at the end
+    if (isStreaming())
+        svgContent << headerContent;
 }
 
 void SVGRenderer::saveToFile(const std::string &filepath)
 {
+    if (isStreaming()) {
+        // The body has already gone to the stream; it cannot be written anywhere else
+        if (!streamSink || filepath != streamPath) {
+            SVG_ERROR("SVGRenderer: Cannot save to " << filepath << " while streaming to "
+                << (streamSink ? streamPath : std::string("an output sink")) << "; call finish()");
+            return;
+        }
+        if (!finish())
+            SVG_ERROR("SVGRenderer: Failed to write " << filepath);
+        return;
+    }
+
+    svgContent.flush();
+    defsContent.flush();
+    std::unique_ptr<IOutputSink> file = openOutputFile(filepath);
+    if (file && (!writeDocument(*file) || !file->close()))
+        SVG_ERROR("SVGRenderer: Failed to write " << filepath);
+}
+
+std::unique_ptr<IOutputSink> SVGRenderer::openOutputFile(const std::string& path) const
+{
+    // .svgz is written gzip-compressed
+    bool compressed = path.size() >= 5 && (path.compare(path.size() - 5, 5, ".svgz") == 0 || path.compare(path.size() - 5, 5, ".SVGZ") == 0);
+    if (compressed && !GzipSink::available()) {
+        SVG_ERROR("SVGRenderer: Cannot write " << path << ": built without zlib");
+        return nullptr;
+    }
+
+    std::unique_ptr<FileDescriptorSink> file = FileDescriptorSink::open(path);
+    if (!file) {
+        SVG_ERROR("SVGRenderer: Cannot open " << path << " for writing");
+        return nullptr;
+    }
+    if (compressed)
+        return std::unique_ptr<IOutputSink>(new GzipSink(std::move(file), compressionLevel));
+    return file;
+}
+
+bool SVGRenderer::writeDocument(IOutputSink& sink) const
+{
+    static const char defsOpen[] = "  <defs>\n";
+    static const char defsClose[] = "  </defs>\n";
+    static const char styleOpen[] = "  <style>\n";
+    static const char styleClose[] = "  </style>\n";
+    static const char svgClose[] = "</svg>";
+
+    // Header, defs and body are kept apart so defs can be added at any time; one gather write joins them.
+    // Minified output skips the indentation and line break around the defs tags.
+    const std::string& defs = defsSink.str();
+    const std::string& body = bodySink.str();
+    const size_t skip = minify ? 2 : 0;     // Indentation
+    const size_t layout = minify ? 3 : 0;   // Indentation and line break
+    OutputBuffer pieces[] = {
+        { headerContent.data(), headerContent.size() },
+        { defsOpen + skip, defs.empty() ? 0 : sizeof(defsOpen) - 1 - layout },
+        { defs.data(), defs.size() },
+        { defsClose + skip, defs.empty() ? 0 : sizeof(defsClose) - 1 - layout },
+        { styleOpen + skip, styleContent.empty() ? 0 : sizeof(styleOpen) - 1 - layout },
+        { styleContent.data(), styleContent.size() },
+        { styleClose + skip, styleContent.empty() ? 0 : sizeof(styleClose) - 1 - layout },
+        { body.data(), body.size() },
+        { svgClose, sizeof(svgClose) - 1 }
+    };
+    return sink.writev(pieces, sizeof(pieces) / sizeof(pieces[0]));
+}
+
+bool SVGRenderer::streamTo(const std::string& path)
+{
+    std::unique_ptr<IOutputSink> file = openOutputFile(path);
+    if (!file)
+        return false;
+    svgContent.setSink(file.get());
+    streamSink = std::move(file);
+    streamPath = path;
+    return true;
+}
+
+void SVGRenderer::setOutputSink(IOutputSink* sink)
+{
+    svgContent.setSink(sink ? sink : &bodySink);
+    streamSink.reset();
+    streamPath.clear();
+}
+
+void SVGRenderer::setMinify(bool enabled, int precision)
+{
+    minify = enabled;
+    indent = enabled ? "" : "  ";
+    newline = enabled ? "" : "\n";
+
+    NumberFormat format = enabled ? NumberFormat::fixed(precision) : NumberFormat::shortest();
+    format.leadingZero = !enabled;
+    setNumberFormat(format);
+}
+
+void SVGRenderer::setStyleClasses(bool enabled)
+{
+    styleClasses = enabled;
+}
+
+void SVGRenderer::setCompressionLevel(int level)
+{
+    compressionLevel = level;
+}
+
+void SVGRenderer::setReuseGeometry(bool enabled)
+{
+    reuseGeometry = enabled;
+}
+
+void SVGRenderer::setNumberFormat(const NumberFormat& format)
+{
+    svgContent.setNumberFormat(format);
+    defsContent.setNumberFormat(format);
+    geometryContent.setNumberFormat(format);
+}
+
+bool SVGRenderer::finish()
+{
+    svgContent.flush();
+    defsContent.flush();
+    if (!isStreaming()) {
+        documentSink.clear();
+        return writeDocument(documentSink);
+    }
+
+    const std::string& defs = defsSink.str();
+    if (!defs.empty())
+        svgContent << indent << "<defs>" << newline << defs << indent << "</defs>" << newline;
+    if (!styleContent.empty()) // Style rules apply to the whole document wherever the block is
+        svgContent << indent << "<style>" << newline << styleContent << indent << "</style>" << newline;
     svgContent << R"(</svg>)";
-    std::ofstream outFile(filepath);
-    if (outFile.is_open())
-    {
-        outFile << svgContent.str();
-        outFile.close();
+    bool ok = svgContent.flush();
+    if (streamSink) {
+        ok = streamSink->close() && ok;
+        svgContent.setSink(&bodySink);
+        streamSink.reset();
+        streamPath.clear();
     }
+    return ok;
 }
 
 void SVGRenderer::drawCircle(float x, float y, float radius)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <circle cx=")" << x << R"(" cy=")" << y
-               << R"(" r=")" << radius
-               << R"(" fill=")" << fillColor << R"(" stroke=")" << strokeColor
-               << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    svgContent << indent << R"(<circle cx=")" << x << R"(" cy=")" << y
+               << R"(" r=")" << radius << '"';
+    writePaint(true);
+    svgContent << "/>" << newline;
 }
 
 void SVGRenderer::drawSquare(float x, float y, float size)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <rect x=")" << x << R"(" y=")" << y
-               << R"(" width=")" << size << R"(" height=")" << size
-               << R"(" fill=")" << fillColor << R"(" stroke=")" << strokeColor
-               << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    drawRectangle(x, y, size, size);
 }
 
 void SVGRenderer::drawRectangle(float x, float y, float width, float height)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <rect x=")" << x << R"(" y=")" << y
-        << R"(" width=")" << width << R"(" height=")" << height
-        << R"(" fill=")" << fillColor << R"(" stroke=")" << strokeColor
-        << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    svgContent << indent << "<rect";
+    if (!minify || x != 0.0f)
+        svgContent << R"( x=")" << x << '"';
+    if (!minify || y != 0.0f)
+        svgContent << R"( y=")" << y << '"';
+    svgContent << R"( width=")" << width << R"(" height=")" << height << '"';
+    writePaint(true);
+    svgContent << "/>" << newline;
 }
 
 void SVGRenderer::drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <polygon points=")"
-               << x1 << "," << y1 << " "
-               << x2 << "," << y2 << " "
-               << x3 << "," << y3
-               << R"(" fill=")" << fillColor << R"(" stroke=")" << strokeColor
-               << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    drawPolygon({ { x1, y1 }, { x2, y2 }, { x3, y3 } });
 }
 
 void SVGRenderer::drawEllipse(float centerX, float centerY, float radiusX, float radiusY)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <ellipse cx=")" << centerX << R"(" cy=")" << centerY
-               << R"(" rx=")" << radiusX << R"(" ry=")" << radiusY
-               << R"(" fill=")" << fillColor << R"(" stroke=")" << strokeColor
-               << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    svgContent << indent << R"(<ellipse cx=")" << centerX << R"(" cy=")" << centerY
+               << R"(" rx=")" << radiusX << R"(" ry=")" << radiusY << '"';
+    writePaint(true);
+    svgContent << "/>" << newline;
 }
 
 
 
 void SVGRenderer::drawLine(const Point2D& p1, const Point2D& p2)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <line x1=")" << p1.x << R"(" y1=")" << p1.y
-        << R"(" x2=")" << p2.x << R"(" y2=")" << p2.y
-        << R"(" stroke=")" << strokeColor
-        << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    svgContent << indent << R"(<line x1=")" << p1.x << R"(" y1=")" << p1.y
+        << R"(" x2=")" << p2.x << R"(" y2=")" << p2.y << '"';
+    writePaint(false);
+    svgContent << "/>" << newline;
 }
 
 void SVGRenderer::drawPolyline(const std::vector<Point2D>& points)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <polyline points=")";
-    for (size_t i = 0; i < points.size(); ++i) {
-        svgContent << points[i].x << "," << points[i].y;
-        if (i < points.size() - 1) {
-            svgContent << " ";
-        }
+    if (!reuseGeometry || !beginReusedPoints("polyline", points, true)) {
+        svgContent << indent << R"(<polyline points=")";
+        writePointList(svgContent, points);
+        svgContent << R"(" fill="none")";
     }
-    svgContent << R"(" fill="none" stroke=")" << strokeColor
-        << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    writePaint(false);
+    svgContent << "/>" << newline;
 }
 
 void SVGRenderer::drawPolygon(const std::vector<Point2D>& points)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <polygon points=")";
-    for (size_t i = 0; i < points.size(); ++i) {
-        svgContent << points[i].x << "," << points[i].y;
-        if (i < points.size() - 1) {
-            svgContent << " ";
-        }
+    if (!reuseGeometry || !beginReusedPoints("polygon", points, false)) {
+        svgContent << indent << R"(<polygon points=")";
+        writePointList(svgContent, points);
+        svgContent << '"';
     }
-    svgContent << R"(" fill=")" << fillColor << R"(" stroke=")" << strokeColor
-        << R"(" stroke-width=")" << strokeWidth << R"("/>)" << "\n";
+    writePaint(true);
+    svgContent << "/>" << newline;
 }
 
 void SVGRenderer::drawText(float x, float y, const std::string& textContent, int fontSize, const std::string& typeface, const std::string& fontFilePath)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <text x=")" << x << R"(" y=")" << y
-        << R"(" font-family=")" << typeface << R"(" font-size=")" << fontSize
-        << R"(" fill=")" << fillColor << R"(" stroke=")" << strokeColor
-        << R"(" stroke-width=")" << strokeWidth << R"(">)";
-    svgContent << textContent << R"(</text>)" << "\n";
+    svgContent << indent << R"(<text x=")" << x << R"(" y=")" << y
+        << R"(" font-family=")" << typeface << R"(" font-size=")" << fontSize << '"';
+    writePaint(true);
+    svgContent << ">" << textContent << R"(</text>)" << newline;
 }
 
 void SVGRenderer::drawPath(const std::vector<PathCommand>& segments, unsigned long fillColour, unsigned long strokeColour, float fillOpacity, float strokeOpacity, float strokeWidth)
 {
-    emitDefsIfNeeded();
-    svgContent << R"(  <path d=")";
+    if (reuseGeometry && beginReusedPath(segments)) {
+        // The <use> carries the paint, like the path would have
+    }
+    else {
+        svgContent << indent << R"(<path d=")";
+        writePathData(svgContent, segments);
+        svgContent << '"';
+    }
+
+    beginPaint();
+    if (!minify) {
+        paintProperty("fill", fillIsPaintServer ? fillColor : rgbaToSVGColour(fillColour));
+        paintProperty("stroke", strokeIsPaintServer ? strokeColor : rgbaToSVGColour(strokeColour));
+        paintProperty("fill-opacity", fillOpacity);
+        if (fillRule == FillRule::EvenOdd)
+            paintProperty("fill-rule", "evenodd");
+        paintProperty("stroke-opacity", strokeOpacity);
+        paintProperty("stroke-width", strokeWidth);
+        writeStrokeStyle();
+    }
+    else {
+        // Transparent colours are written as "none"; defaults (black fill, no stroke, opacity 1) are left out
+        if (fillIsPaintServer)
+            paintProperty("fill", fillColor);
+        else if ((fillColour & 0xFF) == 0)
+            paintProperty("fill", "none");
+        else if ((fillColour & 0xFFFFFF00) != 0)
+            paintColour("fill", rgbaToSVGColour(fillColour));
+        if (fillOpacity != 1.0f)
+            paintProperty("fill-opacity", fillOpacity);
+        if (fillRule == FillRule::EvenOdd)
+            paintProperty("fill-rule", "evenodd");
+
+        if ((strokeIsPaintServer || (strokeColour & 0xFF) != 0) && strokeWidth > 0.0f) {
+            paintColour("stroke", strokeIsPaintServer ? strokeColor : rgbaToSVGColour(strokeColour));
+            if (strokeOpacity != 1.0f)
+                paintProperty("stroke-opacity", strokeOpacity);
+            if (strokeWidth != 1.0f)
+                paintProperty("stroke-width", strokeWidth);
+            writeStrokeStyle();
+        }
+    }
+    endPaint();
+    svgContent << (minify ? "/>" : " />");
+    svgContent << newline;
+
+    SVG_DEBUG("SVGRenderer path fill = " << rgbaToSVGColour(fillColour)
+        << ", stroke = " << rgbaToSVGColour(strokeColour));
+}
+
+void SVGRenderer::writePaint(bool fillable)
+{
+    beginPaint();
+    if (!minify) {
+        if (fillable)
+            paintProperty("fill", fillColor);
+        if (fillable && fillRule == FillRule::EvenOdd)
+            paintProperty("fill-rule", "evenodd");
+        paintProperty("stroke", strokeColor);
+        paintProperty("stroke-width", strokeWidth);
+        writeStrokeStyle();
+    }
+    else {
+        // Only what differs from the SVG defaults: black fill, no stroke, stroke width 1. As in
+        // drawPath, a transparent fill is written as "none" and a stroke that cannot show
+        // (transparent or zero width) is left out.
+        if (fillable && !fillIsPaintServer && isTransparent(fillColor))
+            paintProperty("fill", "none");
+        else if (fillable && !isDefaultFill(fillColor))
+            paintColour("fill", fillColor);
+        if (fillable && fillRule == FillRule::EvenOdd)
+            paintProperty("fill-rule", "evenodd");
+        if (!strokeColor.empty() && strokeWidth > 0.0f && (strokeIsPaintServer || !isTransparent(strokeColor))) {
+            paintColour("stroke", strokeColor);
+            if (strokeWidth != 1.0f)
+                paintProperty("stroke-width", strokeWidth);
+            writeStrokeStyle();
+        }
+    }
+    endPaint();
+}
+
+void SVGRenderer::writeStrokeStyle()
+{
+    if (strokeStyle.isDefault())
+        return;
+    if (strokeStyle.cap != LineCap::Butt)
+        paintProperty("stroke-linecap", strokeStyle.cap == LineCap::Round ? "round" : "square");
+    if (strokeStyle.join != LineJoin::Miter)
+        paintProperty("stroke-linejoin", strokeStyle.join == LineJoin::Round ? "round" : "bevel");
+    if (strokeStyle.miterLimit != 4.0f)
+        paintProperty("stroke-miterlimit", strokeStyle.miterLimit);
+    if (!strokeStyle.dashArray.empty()) {
+        string list;
+        char text[NumberFormat::MaxLength];
+        for (float dash : strokeStyle.dashArray) {
+            if (!list.empty())
+                list += ',';
+            list.append(text, svgContent.getNumberFormat().format(dash, text));
+        }
+        paintProperty("stroke-dasharray", list);
+        if (strokeStyle.dashOffset != 0.0f)
+            paintProperty("stroke-dashoffset", strokeStyle.dashOffset);
+    }
+}
+
+bool SVGRenderer::isDefaultFill(const string& colour)
+{
+    return colour.empty() || colour == "#000000" || colour == "#000" || colour == "#000000ff" || colour == "black";
+}
+
+bool SVGRenderer::isTransparent(const string& colour)
+{
+    // rgbtoHex() adds the alpha digits that parseColorString does not read: "#rrggbbaa"
+    if (colour.size() == 9 && colour[0] == '#')
+        return colour.compare(7, 2, "00") == 0;
+    unsigned long rgba;
+    return tryParseColorString(colour, rgba) && (rgba & 0xFF) == 0;
+}
+
+void SVGRenderer::beginPaint()
+{
+    paintDeclarations.clear();
+}
+
+void SVGRenderer::paintProperty(const char* name, const char* value, size_t length)
+{
+    if (!styleClasses) {
+        svgContent << ' ' << name << "=\"";
+        svgContent.write(value, length);
+        svgContent << '"';
+        return;
+    }
+
+    if (length == 0)
+        return; // An empty presentation attribute means the initial value anyway
+    if (!paintDeclarations.empty())
+        paintDeclarations += ';';
+    paintDeclarations += name;
+    paintDeclarations += ':';
+    paintDeclarations.append(value, length);
+}
+
+void SVGRenderer::paintProperty(const char* name, const string& value)
+{
+    paintProperty(name, value.data(), value.size());
+}
+
+void SVGRenderer::paintProperty(const char* name, float value)
+{
+    char text[NumberFormat::MaxLength];
+    paintProperty(name, text, svgContent.getNumberFormat().format(value, text));
+}
+
+void SVGRenderer::paintColour(const char* name, const string& colour)
+{
+    // "rgb(r,g,b)" and "#rrggbb(aa)" become "#rgb(a)" when every channel has two equal digits
+    string hex = colour;
+    int r, g, b;
+    if (std::sscanf(colour.c_str(), "rgb(%d,%d,%d)", &r, &g, &b) == 3)
+        hex = rgbtoHex(r, g, b, 255);
+    if (hex.size() == 7 || hex.size() == 9) {
+        bool shortens = hex[0] == '#';
+        for (size_t i = 1; shortens && i < hex.size(); i += 2)
+            shortens = std::tolower(hex[i]) == std::tolower(hex[i + 1]);
+        if (shortens) {
+            string text(1, '#');
+            for (size_t i = 1; i < hex.size(); i += 2)
+                text += hex[i];
+            paintProperty(name, text);
+            return;
+        }
+    }
+    paintProperty(name, hex);
+}
+
+void SVGRenderer::endPaint()
+{
+    if (!styleClasses || paintDeclarations.empty())
+        return;
+
+    auto it = styleClassIds.find(paintDeclarations);
+    if (it == styleClassIds.end()) {
+        it = styleClassIds.emplace(paintDeclarations, styleClassIds.size()).first;
+        styleContent += indent;
+        styleContent += indent;
+        styleContent += ".s" + std::to_string(it->second) + '{' + paintDeclarations + '}';
+        styleContent += newline;
+    }
+    svgContent << R"( class="s)" << static_cast<unsigned long>(it->second) << '"';
+}
+
+void SVGRenderer::writeListNumber(BufferedWriter& out, float value, char separator, bool& first, bool& lastHasDot)
+{
+    char text[NumberFormat::MaxLength];
+    size_t length = svgContent.getNumberFormat().format(value, text);
+
+    // Minified lists drop the separator wherever the next number cannot be read as part of the last
+    if (!first && !(minify && (text[0] == '-' || (text[0] == '.' && lastHasDot))))
+        out << (minify ? ' ' : separator);
+    out.write(text, length);
+
+    first = false;
+    lastHasDot = std::memchr(text, '.', length) != nullptr || std::memchr(text, 'e', length) != nullptr;
+}
+
+void SVGRenderer::writePointList(BufferedWriter& out, const std::vector<Point2D>& points)
+{
+    bool first = true, lastHasDot = false;
+    for (const Point2D& point : points) {
+        writeListNumber(out, point.x, ' ', first, lastHasDot);
+        writeListNumber(out, point.y, ',', first, lastHasDot);
+    }
+}
+
+size_t SVGRenderer::numbersLength(const float* values, int count) const
+{
+    char text[NumberFormat::MaxLength];
+    size_t length = 0;
+    for (int i = 0; i < count; ++i)
+        length += svgContent.getNumberFormat().format(values[i], text) + 1;
+    return length;
+}
+
+void SVGRenderer::writeMinifiedPathData(BufferedWriter& out, const std::vector<PathCommand>& segments)
+{
+    const NumberFormat& format = svgContent.getNumberFormat();
+
+    // Where a reader of the output is, which is the rounded position rather than the exact one
+    float curX = 0.0f, curY = 0.0f, startX = 0.0f, startY = 0.0f;
+    float exactX = 0.0f, exactY = 0.0f;
+    char previous = 0;
+    bool first = true, lastHasDot = false;
+
+    for (const PathCommand& cmd : segments) {
+        if (cmd.type == PathCommandType::ClosePath) {
+            out << 'z';
+            previous = 'z';
+            first = true;
+            curX = exactX = startX;
+            curY = exactY = startY;
+            continue;
+        }
+        if (cmd.points.empty())
+            continue;
+
+        // Exact absolute coordinates of the command (H and V carry their value in x)
+        float absolute[6], relative[6], rounded[6];
+        int count = 0;
+        char letter;
+        switch (cmd.type) {
+        case PathCommandType::HorizontalLineTo:
+            absolute[count++] = cmd.points[0].x + (cmd.relative ? exactX : 0.0f);
+            letter = 'h';
+            break;
+        case PathCommandType::VerticalLineTo:
+            absolute[count++] = cmd.points[0].x + (cmd.relative ? exactY : 0.0f);
+            letter = 'v';
+            break;
+        default:
+            for (const Point2D& point : cmd.points) {
+                absolute[count++] = point.x + (cmd.relative ? exactX : 0.0f);
+                absolute[count++] = point.y + (cmd.relative ? exactY : 0.0f);
+            }
+            letter = cmd.type == PathCommandType::MoveTo ? 'm' :
+                cmd.type == PathCommandType::LineTo ? 'l' :
+                cmd.type == PathCommandType::CubicBezier ? 'c' : 'q';
+            break;
+        }
+
+        // Relative offsets are taken from the rounded position so rounding errors do not accumulate
+        for (int i = 0; i < count; ++i) {
+            rounded[i] = format.quantize(absolute[i]);
+            float origin = (letter == 'v' || i % 2 == 1) ? curY : curX;
+            relative[i] = format.quantize(absolute[i] - origin);
+        }
+        bool useRelative = numbersLength(relative, count) <= numbersLength(rounded, count);
+        const float* values = useRelative ? relative : rounded;
+        if (!useRelative)
+            letter = static_cast<char>(std::toupper(letter));
+
+        // A repeated command (or a line after a move) needs no letter
+        char implicit = previous == 'm' ? 'l' : previous == 'M' ? 'L' : previous;
+        if (letter != implicit) {
+            out << letter;
+            first = true;
+        }
+        previous = letter;
+        for (int i = 0; i < count; ++i)
+            writeListNumber(out, values[i], ' ', first, lastHasDot);
+
+        // Advance both the exact and the rounded current point
+        if (letter == 'h' || letter == 'H') {
+            exactX = absolute[0];
+            curX = useRelative ? curX + relative[0] : rounded[0];
+        }
+        else if (letter == 'v' || letter == 'V') {
+            exactY = absolute[0];
+            curY = useRelative ? curY + relative[0] : rounded[0];
+        }
+        else {
+            exactX = absolute[count - 2];
+            exactY = absolute[count - 1];
+            curX = useRelative ? curX + relative[count - 2] : rounded[count - 2];
+            curY = useRelative ? curY + relative[count - 1] : rounded[count - 1];
+        }
+        if (cmd.type == PathCommandType::MoveTo) {
+            startX = curX;
+            startY = curY;
+        }
+    }
+}
+
+void SVGRenderer::writePathData(BufferedWriter& out, const std::vector<PathCommand>& segments)
+{
+    if (minify) {
+        writeMinifiedPathData(out, segments);
+        return;
+    }
 
     for (const auto& cmd : segments) {
         char letter;
@@ -142,37 +614,115 @@ void SVGRenderer::drawPath(const std::vector<PathCommand>& segments, unsigned lo
         default:                                letter = '?'; break;
         }
 
-        svgContent << letter;
+        out << letter;
 
         // Only print coordinates if the command has any points
         for (const auto& pt : cmd.points) {
-            svgContent << ' ' << pt.x << ',' << pt.y;
+            out << ' ' << pt.x << ',' << pt.y;
+        }
+
+        out << ' ';
+    }
+}
+
+bool SVGRenderer::beginReusedPath(const std::vector<PathCommand>& segments)
+{
+    // Geometry is compared with the first point moved to the origin
+    float originX = 0.0f, originY = 0.0f;
+    if (!segments.empty() && segments[0].type == PathCommandType::MoveTo && !segments[0].points.empty()) {
+        originX = segments[0].points[0].x;
+        originY = segments[0].points[0].y;
+    }
+
+    translatedSegments.assign(segments.begin(), segments.end());
+    for (size_t i = 0; i < translatedSegments.size(); ++i) {
+        PathCommand& cmd = translatedSegments[i];
+        if (cmd.relative && i > 0)
+            continue;
+        for (Point2D& point : cmd.points) {
+            if (cmd.type == PathCommandType::HorizontalLineTo)
+                point.x -= originX;
+            else if (cmd.type == PathCommandType::VerticalLineTo)
+                point.x -= originY; // V keeps its value in x
+            else {
+                point.x -= originX;
+                point.y -= originY;
+            }
         }
+    }
+
+    geometryContent << "<path d=\"";
+    writePathData(geometryContent, translatedSegments);
+    geometryContent << "\"/>";
+    return beginReusedGeometry(originX, originY);
+}
 
-        svgContent << ' ';
+bool SVGRenderer::beginReusedPoints(const char* element, const std::vector<Point2D>& points, bool unfilled)
+{
+    float originX = points.empty() ? 0.0f : points[0].x;
+    float originY = points.empty() ? 0.0f : points[0].y;
+
+    translatedPoints.assign(points.begin(), points.end());
+    for (Point2D& point : translatedPoints) {
+        point.x -= originX;
+        point.y -= originY;
     }
 
-    svgContent << R"(" fill=")" << rgbaToSVGColour(fillColour)
-        << R"(" stroke=")" << rgbaToSVGColour(strokeColour)
-        << R"(" fill-opacity=")" << fillOpacity
-        << R"(" stroke-opacity=")" << strokeOpacity
-        << R"(" stroke-width=")" << strokeWidth
-        << R"(" />)" << "\n";
+    geometryContent << '<' << element << R"( points=")";
+    writePointList(geometryContent, translatedPoints);
+    geometryContent << (unfilled ? R"(" fill="none"/>)" : R"("/>)");
+    return beginReusedGeometry(originX, originY);
+}
+
+bool SVGRenderer::beginReusedGeometry(float originX, float originY)
+{
+    geometryContent.flush();
+    const string& geometry = geometrySink.str();
+
+    const uint64_t key = fnv1a(geometry), check = polynomialHash(geometry);
+    auto it = geometrySymbols.find(key);
+    if (it == geometrySymbols.end()) {
+        // First occurrence: written in place. The table stops growing at its limit.
+        if (geometrySymbols.size() < MaxReusedGeometries)
+            geometrySymbols.emplace(key, ReusedGeometry{ check, geometry.size(), string() });
+        geometrySink.clear();
+        return false;
+    }
+    if (it->second.check != check || it->second.size != geometry.size()) {
+        // Another geometry with the same key: this one is not reused
+        geometrySink.clear();
+        return false;
+    }
+    ReusedGeometry& entry = it->second;
 
-    std::cout << "SVGRenderer path fill = " << rgbaToSVGColour(fillColour)
-        << ", stroke = " << rgbaToSVGColour(strokeColour) << std::endl;
+    if (entry.symbolId.empty()) {
+        // Second occurrence: the geometry becomes a symbol in defs
+        entry.symbolId = generateId("sym");
+        defsContent << indent << R"(<symbol id=")" << entry.symbolId << R"(" overflow="visible">)" << geometry
+            << "</symbol>" << newline;
+    }
+    geometrySink.clear();
+
+    svgContent << indent << R"(<use href="#)" << entry.symbolId << '"';
+    if (!minify || originX != 0.0f)
+        svgContent << R"( x=")" << originX << '"';
+    if (!minify || originY != 0.0f)
+        svgContent << R"( y=")" << originY << '"';
+    return true;
 }
 
 void SVGRenderer::setFillColor(int r, int g, int b, int a) // Updated signature
 {
     currentfillColor = (r << 24) | (g << 16) | (b << 8) | a;
     fillColor = rgbtoHex(r, g, b, a);
+    fillIsPaintServer = false;
 }
 
 void SVGRenderer::setStrokeColor(int r, int g, int b, int a)
 {
     currentStrokeColor = (r << 24) | (g << 16) | (b << 8) | a;
     strokeColor = rgbtoHex(r, g, b, a);
+    strokeIsPaintServer = false;
 }
 
 void SVGRenderer::setStrokeWidth(float width)
@@ -180,6 +730,16 @@ void SVGRenderer::setStrokeWidth(float width)
     strokeWidth = width;
 }
 
+void SVGRenderer::setFillRule(FillRule rule)
+{
+    fillRule = rule;
+}
+
+void SVGRenderer::setStrokeStyle(const StrokeStyle& style)
+{
+    strokeStyle = style;
+}
+
 void SVGRenderer::setFillOpacity(float opacity)
 {
     currentFillOpacity = opacity;
@@ -192,13 +752,14 @@ void SVGRenderer::setStrokeOpacity(float opacity)
 
 void SVGRenderer::drawPath(const std::string& dStr)
 {
-    emitDefsIfNeeded();
     SVGPath path(dStr);
     path.setDefaultFillColour(currentfillColor);
     path.setDefaultStrokeColour(currentStrokeColor);
     path.setDefaultStrokeWidth(strokeWidth);
     path.setDefaultFillOpacity(currentFillOpacity);
     path.setDefaultStrokeOpacity(currentStrokeOpacity);
+    path.fillRule = fillRule;
+    path.strokeStyle = strokeStyle;
     path.render(this);
 
 
@@ -206,80 +767,188 @@ void SVGRenderer::drawPath(const std::string& dStr)
 
 void SVGRenderer::drawLinearGradient(const string& id, const Point2D& P1, const Point2D& P2, const vector<pair<float, string>>& stops)
 {
-    defsContent << "  <linearGradient id=\"" << id << "\" "
+    gradientIds.insert(id);
+    writtenIds.insert(id); // Referenced by this id from setFillGradient(): it cannot be renamed
+    defsContent << indent << "<linearGradient id=\"" << id << "\" "
         << "x1=\"" << P1.x << "%\" y1=\"" << P1.y << "%\" "
-        << "x2=\"" << P2.x << "%\" y2=\"" << P2.y << "%\">\n";
+        << "x2=\"" << P2.x << "%\" y2=\"" << P2.y << "%\">" << newline;
     for (auto& stop : stops) {
-        defsContent << "    <stop offset=\"" << stop.first * 100.0f << "%\" "
-            << "stop-color=\"" << stop.second << "\" />\n";
+        defsContent << indent << indent << "<stop offset=\"" << stop.first * 100.0f << "%\" "
+            << "stop-color=\"" << stop.second << "\" />" << newline;
     }
-    defsContent << "  </linearGradient>\n";
+    defsContent << indent << "</linearGradient>" << newline;
 }
 
 void SVGRenderer::drawRadialGradient(const string& id, const Point2D& centre, float r, const vector<pair<float, string>>& stops)
 {
-    defsContent << "  <radialGradient id=\"" << id << "\" "
-        << "cx=\"" << centre.x << "%\" cy=\"" << centre.y << "%\" r=\"" << r << "%\">\n";
+    gradientIds.insert(id);
+    writtenIds.insert(id);
+    defsContent << indent << "<radialGradient id=\"" << id << "\" "
+        << "cx=\"" << centre.x << "%\" cy=\"" << centre.y << "%\" r=\"" << r << "%\">" << newline;
     for (auto& stop : stops) {
-        defsContent << "    <stop offset=\"" << stop.first * 100 << "%\" "
-            << "stop-color=\"" << stop.second << "\" />\n";
+        defsContent << indent << indent << "<stop offset=\"" << stop.first * 100 << "%\" "
+            << "stop-color=\"" << stop.second << "\" />" << newline;
     }
-    defsContent << "  </radialGradient>\n";
+    defsContent << indent << "</radialGradient>" << newline;
 }
 
 void SVGRenderer::setFillGradient(const string& gradientId)
 {
+    if (!gradientIds.count(gradientId))
+        SVG_WARN("SVGRenderer: Fill references undefined gradient: #" << gradientId);
     setFillColor(std::string("url(#") + gradientId + ")");
 }
 
 void SVGRenderer::setStrokeGradient(const string& gradientId)
 {
+    if (!gradientIds.count(gradientId))
+        SVG_WARN("SVGRenderer: Stroke references undefined gradient: #" << gradientId);
     setStrokeColor(std::string("url(#") + gradientId + ")");
 }
 
+void SVGRenderer::setFillGradient(const SVGGradient& gradient)
+{
+    setFillColor("url(#" + defineGradient(gradient) + ")");
+}
+
+void SVGRenderer::setStrokeGradient(const SVGGradient& gradient)
+{
+    setStrokeColor("url(#" + defineGradient(gradient) + ")");
+}
+
+string SVGRenderer::defineGradient(const SVGGradient& gradient)
+{
+    auto it = gradientDefs.find(&gradient);
+    if (it != gradientDefs.end())
+        return it->second;
+
+    string id = claimId(gradient.id, "gradient");
+    gradientDefs.emplace(&gradient, id);
+    gradientIds.insert(id);
+
+    if (gradient.isRadial()) {
+        const SVGRadialGradient& radial = static_cast<const SVGRadialGradient&>(gradient);
+        defsContent << indent << "<radialGradient id=\"" << id << "\" "
+            << "cx=\"" << radial.centre.x << "\" cy=\"" << radial.centre.y << "\" r=\"" << radial.radius << "\" "
+            << "fx=\"" << radial.focal.x << "\" fy=\"" << radial.focal.y << "\"";
+    }
+    else {
+        const SVGLinearGradient& linear = static_cast<const SVGLinearGradient&>(gradient);
+        defsContent << indent << "<linearGradient id=\"" << id << "\" "
+            << "x1=\"" << linear.p1.x << "\" y1=\"" << linear.p1.y << "\" "
+            << "x2=\"" << linear.p2.x << "\" y2=\"" << linear.p2.y << "\"";
+    }
+    if (gradient.units == GradientUnits::UserSpaceOnUse)
+        defsContent << " gradientUnits=\"userSpaceOnUse\"";
+    if (gradient.spread == SpreadMethod::Reflect)
+        defsContent << " spreadMethod=\"reflect\"";
+    else if (gradient.spread == SpreadMethod::Repeat)
+        defsContent << " spreadMethod=\"repeat\"";
+    if (!gradient.gradientTransformStr.empty())
+        defsContent << " gradientTransform=\"" << gradient.gradientTransformStr << "\"";
+    defsContent << ">" << newline;
+
+    for (const GradientStop& stop : gradient.stops) {
+        defsContent << indent << indent << "<stop offset=\"" << stop.offset << "\" "
+            << "stop-color=\"" << rgbaToSVGColour(stop.colour) << "\" "
+            << "stop-opacity=\"" << (stop.colour & 0xFF) / 255.0f << "\" />" << newline;
+    }
+    defsContent << indent << (gradient.isRadial() ? "</radialGradient>" : "</linearGradient>") << newline;
+    return id;
+}
+
 void SVGRenderer::setFillColor(const std::string& css)
 {
     currentfillColor = 0;
     fillColor = css;
+    fillIsPaintServer = css.compare(0, 4, "url(") == 0;
 }
 
 void SVGRenderer::setStrokeColor(const std::string& css)
 {
     currentStrokeColor = 0;
     strokeColor = css;
+    strokeIsPaintServer = css.compare(0, 4, "url(") == 0;
 }
 
-void SVGRenderer::emitDefsIfNeeded()
+void SVGRenderer::drawInstance(SVGElements* definition, const Transform& transform)
 {
-    if (!defsEmitted && !defsContent.str().empty()) {
-        svgContent << "  <defs>\n" << defsContent.str() << "  </defs>\n";
-        defsEmitted = true;
-    }
-}
+    auto it = instanceIds.find(definition);
+    if (it != instanceIds.end() && it->second.empty())
+        return; // The definition refers to itself: a reference cycle renders nothing
+
+    bool transformed = !transform.isIdentity();
+    if (transformed)
+        svgContent << indent << R"(<g transform=")" << matrixString(transform) << R"(">)" << newline;
 
+    if (it != instanceIds.end()) {
+        // Already serialised once: refer to that output instead of writing the geometry again
+        svgContent << indent << R"(<use href="#)" << it->second << R"("/>)" << newline;
+    }
+    else {
+        string id = claimId(definition->id, "instance");
+        instanceIds.emplace(definition, ""); // Marks the definition as being serialised
+        svgContent << indent << R"(<g id=")" << id << R"(">)" << newline;
+        definition->render(this);
+        svgContent << indent << R"(</g>)" << newline;
+        instanceIds[definition] = id;
+    }
 
-std::stack<bool> groupOpenStack;
+    if (transformed)
+        svgContent << indent << R"(</g>)" << newline;
+}
 
 void SVGRenderer::pushTransform(const string& transformStr) {
-    svgContent << R"(  <g transform=")" << '"' << transformStr << '"' << R"(>")" << "\n";
+    svgContent << indent << R"(<g transform=")" << transformStr << R"(">)" << newline;
     groupOpenStack.push(true);
 }
 
+void SVGRenderer::pushTransform(const Transform& transform) {
+    pushTransform(matrixString(transform));
+}
+
+string SVGRenderer::generateId(const char* kind)
+{
+    // Documents may use any id, this renderer's earlier output included: skip the taken ones
+    string id;
+    do {
+        id = string("svgr-") + kind + std::to_string(generatedIdCount++);
+    } while (!writtenIds.insert(id).second);
+    return id;
+}
+
+string SVGRenderer::claimId(const string& wanted, const char* kind)
+{
+    // Gradients and instances are referenced through the id returned here, so a duplicated
+    // document id can be replaced
+    if (!wanted.empty() && writtenIds.insert(wanted).second)
+        return wanted;
+    return generateId(kind);
+}
+
+string SVGRenderer::matrixString(const Transform& transform) const
+{
+    auto m = transform.getMatrix();
+    const NumberFormat& format = svgContent.getNumberFormat();
+    return "matrix(" + format.toString(m[0]) + ' ' + format.toString(m[3]) + ' ' + format.toString(m[1]) + ' '
+        + format.toString(m[4]) + ' ' + format.toString(m[2]) + ' ' + format.toString(m[5]) + ')';
+}
+
 void SVGRenderer::popTransform() {
     if (!groupOpenStack.empty() && groupOpenStack.top()) {
-        svgContent << R"(  </g>)" << "\n";
+        svgContent << indent << R"(</g>)" << newline;
         groupOpenStack.pop();
     }
 }
 
 void SVGRenderer::beginGroup() {
     groupOpenStack.push(false); // nhóm không có transform
-    svgContent << R"(  <g>)" << "\n";
+    svgContent << indent << R"(<g>)" << newline;
 }
 
 void SVGRenderer::endGroup() {
     if (!groupOpenStack.empty()) {
-        svgContent << R"(  </g>)" << "\n";
+        svgContent << indent << R"(</g>)" << newline;
         groupOpenStack.pop();
     }
 }
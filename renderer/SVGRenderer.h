@@ -2,8 +2,13 @@
 #pragma once
 #include "IRenderer.h"
 #include "ColorUtils.h"
+#include "OutputSink.h"
 #include <sstream>
 #include <iomanip>
+#include <unordered_set>
+#include <unordered_map>
+#include <stack>
+#include <cstdint>
 
 class SVGRenderer : public IRenderer
 {
@@ -11,6 +16,39 @@ public:
     void initialize(int width, int height) override;
     void saveToFile(const std::string &filepath) override;
 
+    // Streams the document to 'path' while it is drawn instead of holding it in memory.
+    // Call before initialize(); finish() (or saveToFile() with the same path) completes the
+    // file, appending the defs.
+    bool streamTo(const std::string& path);
+    // Sends the document to a caller-owned sink (nullptr: back to the internal memory buffer).
+    // finish() completes it; saveToFile() refuses while a sink is set.
+    void setOutputSink(IOutputSink* sink);
+    // Smallest output: no layout whitespace, relative path commands where shorter, no separators
+    // the grammar does not need, default attributes left out, short colours, numbers rounded to
+    // 'precision' decimals. Call before initialize().
+    void setMinify(bool enabled, int precision = 2);
+
+    // Writes each distinct fill/stroke combination once, as a CSS class in a <style> block, and
+    // refers to it with class="sN". The block precedes the body (it trails a streamed body).
+    void setStyleClasses(bool enabled);
+
+    // Paths, polygons and polylines repeated with only a translation difference are written as
+    // a <symbol> plus <use x y> elements carrying their own paint. The first occurrence stays
+    // inline and the symbol is written on the second, so a reused geometry appears twice in
+    // the output; in exchange, shapes that never repeat cost no indirection.
+    void setReuseGeometry(bool enabled);
+
+    // zlib level (0..9) of .svgz files written by saveToFile()/streamTo()
+    void setCompressionLevel(int level);
+
+    // Formatting of every number written (shortest round-trip by default)
+    void setNumberFormat(const NumberFormat& format);
+
+    // Closes the document and flushes it to the current sink
+    bool finish();
+    // The finished document when no sink or stream was set (valid after finish())
+    const std::string& getDocument() const { return documentSink.str(); }
+
     void drawCircle(float x, float y, float radius) override;
     void drawSquare(float x, float y, float size) override;
     void drawRectangle(float x, float y, float width, float height) override;
@@ -21,13 +59,18 @@ public:
     void drawPolygon(const std::vector<Point2D>& points) override;
     void drawText(float x, float y, const std::string& textContent, int fontSize, const std::string& typeface, const std::string& fontFilePath) override;
     void drawPath(const std::vector<PathCommand>& segments, unsigned long fillColour, unsigned long strokeColour, float fillOpacity, float strokeOpacity, float strokeWidth) override;
+    void drawInstance(SVGElements* definition, const Transform& transform) override;
     void pushTransform(const string& transformStr) override;
+    void pushTransform(const Transform& transform) override;
     void popTransform() override;
     void beginGroup() override;
     void endGroup() override;
     void setFillColor(int r, int g, int b, int a = 255) override;
     void setStrokeColor(int r, int g, int b, int a = 255) override;
     void setStrokeWidth(float width) override;
+    void setFillRule(FillRule rule) override;
+    void setStrokeStyle(const StrokeStyle& style) override;
+    void setRenderCache(RenderCache*) override {} // Output is text: nothing to cache
     void setFillOpacity(float opacity);
     void setStrokeOpacity(float opacity);
     void drawPath(const std::string& dStr) override;
@@ -35,17 +78,87 @@ public:
     void drawRadialGradient(const string& id, const Point2D& centre, float r, const vector<pair<float, string>>& stops) override;
     void setFillGradient(const string& gradientId) override;
     void setStrokeGradient(const string& gradientId) override;
+    void setFillGradient(const SVGGradient& gradient) override;
+    void setStrokeGradient(const SVGGradient& gradient) override;
     void setFillColor(const string& css) override;
     void setStrokeColor(const string& css) override;
 
 private:
-    stringstream svgContent;
-    ostringstream defsContent;
+    // The header, defs and body are built separately and joined when the document is written
+    std::string headerContent;
+    MemorySink defsSink;
+    BufferedWriter defsContent{ &defsSink, 4096 };
+    MemorySink bodySink;                     // Default destination of the body
+    MemorySink documentSink;                 // Assembled by finish()
+    std::unique_ptr<IOutputSink> streamSink; // Set by streamTo()
+    std::string streamPath;                  // Of streamSink
+    BufferedWriter svgContent{ &bodySink };
+    bool isStreaming() const { return svgContent.getSink() != &bodySink; }
+    int compressionLevel = GzipSink::DefaultLevel;
+    std::unique_ptr<IOutputSink> openOutputFile(const std::string& path) const; // gzip for .svgz
+    bool minify = false;
+    const char* indent = "  ";
+    const char* newline = "\n";
+    bool styleClasses = false;
+    string paintDeclarations;                     // Paint of the element being written, in class mode
+    unordered_map<string, size_t> styleClassIds;  // Declarations -> class number
+    string styleContent;
+    void writePaint(bool fillable);
+    void writeStrokeStyle(); // Only the properties that differ from the defaults
+    void beginPaint();
+    void paintProperty(const char* name, const char* value, size_t length);
+    void paintProperty(const char* name, const string& value);
+    void paintProperty(const char* name, float value);
+    void paintColour(const char* name, const string& colour); // Shortened colour
+    void endPaint();
+    static bool isDefaultFill(const string& colour);
+    // "none", "transparent" or a colour with zero alpha (e.g. "#rrggbb00"): paints nothing
+    static bool isTransparent(const string& colour);
+    void writeListNumber(BufferedWriter& out, float value, char separator, bool& first, bool& lastHasDot);
+    void writePointList(BufferedWriter& out, const std::vector<Point2D>& points);
+    size_t numbersLength(const float* values, int count) const;
+    void writeMinifiedPathData(BufferedWriter& out, const std::vector<PathCommand>& segments);
+    void writePathData(BufferedWriter& out, const std::vector<PathCommand>& segments);
+
+    // Geometry reuse, keyed by a hash of the translation-normalised geometry so that memory
+    // stays bounded however long the paths are (at most MaxReusedGeometries small entries)
+    struct ReusedGeometry {
+        uint64_t check;   // Second hash: a key match with another check or size is a collision
+        size_t size;
+        string symbolId;  // Empty until seen twice
+    };
+    static const size_t MaxReusedGeometries = 1 << 16;
+    bool reuseGeometry = false;
+    unordered_map<uint64_t, ReusedGeometry> geometrySymbols;
+    MemorySink geometrySink;
+    BufferedWriter geometryContent{ &geometrySink, 4096 };
+    std::vector<PathCommand> translatedSegments;
+    std::vector<Point2D> translatedPoints;
+    // Each writes an open <use> and returns true when the geometry was seen before
+    bool beginReusedPath(const std::vector<PathCommand>& segments);
+    bool beginReusedPoints(const char* element, const std::vector<Point2D>& points, bool unfilled);
+    bool beginReusedGeometry(float originX, float originY);
+    bool writeDocument(IOutputSink& sink) const;
     string fillColor;
     string strokeColor;
-    bool defsEmitted = false;
-    void emitDefsIfNeeded();
+    std::stack<bool> groupOpenStack; // One entry per open <g>: true when opened by pushTransform
+    unordered_set<string> gradientIds; // ids defined through drawLinearGradient/drawRadialGradient
+    unordered_map<const SVGElements*, string> instanceIds; // definitions already serialised by drawInstance
+    unordered_map<const SVGGradient*, string> gradientDefs; // parsed gradients already written to defs
+    bool fillIsPaintServer = false;
+    bool strokeIsPaintServer = false;
+    string defineGradient(const SVGGradient& gradient);
+    // Every id written to the output so far
+    unordered_set<string> writtenIds;
+    // Id for an unnamed symbol, gradient or instance, distinct from every id written so far
+    string generateId(const char* kind);
+    // 'wanted' (the element's own id) unless it is empty or already written, then generateId()
+    string claimId(const string& wanted, const char* kind);
+    size_t generatedIdCount = 0;
+    string matrixString(const Transform& transform) const;
     float strokeWidth = 1.0f;
+    FillRule fillRule = FillRule::NonZero;
+    StrokeStyle strokeStyle;
     float currentFillOpacity = 1.0f;
     float currentStrokeOpacity = 1.0f;
     unsigned long currentfillColor = 0x000000ff;
@@ -0,0 +1,416 @@
+﻿// src/Stroker.cpp
+#include "Stroker.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace
+{
+    inline float cross(const Point2D& a, const Point2D& b) { return a.x * b.y - a.y * b.x; }
+    inline float dot(const Point2D& a, const Point2D& b) { return a.x * b.x + a.y * b.y; }
+
+    void flattenQuadratic(const Point2D& p0, const Point2D& p1, const Point2D& p2, float tolerance, std::vector<Point2D>& out)
+    {
+        // Wang's formula: segments needed to keep the flattening error under the tolerance
+        float ddx = p0.x - 2.0f * p1.x + p2.x, ddy = p0.y - 2.0f * p1.y + p2.y;
+        int count = static_cast<int>(std::ceil(std::sqrt(std::sqrt(ddx * ddx + ddy * ddy) / (4.0f * tolerance))));
+        count = std::min(std::max(count, 1), 256);
+
+        for (int i = 1; i <= count; ++i) {
+            float t = static_cast<float>(i) / count, u = 1.0f - t;
+            out.push_back(Point2D(u * u * p0.x + 2.0f * u * t * p1.x + t * t * p2.x,
+                u * u * p0.y + 2.0f * u * t * p1.y + t * t * p2.y));
+        }
+    }
+
+    void flattenCubic(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3, float tolerance, std::vector<Point2D>& out)
+    {
+        float ax = p0.x - 2.0f * p1.x + p2.x, ay = p0.y - 2.0f * p1.y + p2.y;
+        float bx = p1.x - 2.0f * p2.x + p3.x, by = p1.y - 2.0f * p2.y + p3.y;
+        float dd = std::sqrt(std::max(ax * ax + ay * ay, bx * bx + by * by));
+        int count = static_cast<int>(std::ceil(std::sqrt(0.75f * dd / tolerance)));
+        count = std::min(std::max(count, 1), 256);
+
+        for (int i = 1; i <= count; ++i) {
+            float t = static_cast<float>(i) / count, u = 1.0f - t;
+            float w0 = u * u * u, w1 = 3.0f * u * u * t, w2 = 3.0f * u * t * t, w3 = t * t * t;
+            out.push_back(Point2D(w0 * p0.x + w1 * p1.x + w2 * p2.x + w3 * p3.x,
+                w0 * p0.y + w1 * p1.y + w2 * p2.y + w3 * p3.y));
+        }
+    }
+}
+
+void flattenPath(const std::vector<PathCommand>& segments, float tolerance, std::vector<Polyline>& out)
+{
+    tolerance = std::max(tolerance, 1e-4f);
+    Point2D current, start;
+    auto currentPolyline = [&]() -> std::vector<Point2D>& {
+        if (out.empty() || out.back().closed) {
+            // Drawing after Z (or without M) continues from the current point
+            out.push_back(Polyline());
+            out.back().points.push_back(current);
+        }
+        return out.back().points;
+    };
+
+    const size_t first = out.size();
+    for (const PathCommand& cmd : segments) {
+        if (cmd.type != PathCommandType::ClosePath && cmd.points.empty())
+            continue;
+
+        const float ox = cmd.relative ? current.x : 0.0f, oy = cmd.relative ? current.y : 0.0f;
+        switch (cmd.type) {
+        case PathCommandType::MoveTo:
+            current = start = Point2D(cmd.points[0].x + ox, cmd.points[0].y + oy);
+            out.push_back(Polyline());
+            out.back().points.push_back(current);
+            break;
+        case PathCommandType::LineTo:
+            current = Point2D(cmd.points[0].x + ox, cmd.points[0].y + oy);
+            currentPolyline().push_back(current);
+            break;
+        case PathCommandType::HorizontalLineTo:
+            current.x = cmd.points[0].x + ox;
+            currentPolyline().push_back(current);
+            break;
+        case PathCommandType::VerticalLineTo:
+            current.y = cmd.points[0].x + oy; // V keeps its value in x
+            currentPolyline().push_back(current);
+            break;
+        case PathCommandType::QuadraticBezier: {
+            if (cmd.points.size() < 2)
+                break;
+            Point2D c(cmd.points[0].x + ox, cmd.points[0].y + oy), end(cmd.points[1].x + ox, cmd.points[1].y + oy);
+            flattenQuadratic(current, c, end, tolerance, currentPolyline());
+            current = end;
+            break;
+        }
+        case PathCommandType::CubicBezier: {
+            if (cmd.points.size() < 3)
+                break;
+            Point2D c1(cmd.points[0].x + ox, cmd.points[0].y + oy), c2(cmd.points[1].x + ox, cmd.points[1].y + oy);
+            Point2D end(cmd.points[2].x + ox, cmd.points[2].y + oy);
+            flattenCubic(current, c1, c2, end, tolerance, currentPolyline());
+            current = end;
+            break;
+        }
+        case PathCommandType::ClosePath:
+            if (out.size() > first && !out.back().closed)
+                out.back().closed = true;
+            current = start;
+            break;
+        }
+    }
+}
+
+void Stroker::setStyle(const StrokeStyle& strokeStyle, float width)
+{
+    style = strokeStyle;
+    halfWidth = std::max(width, 0.0f) * 0.5f;
+
+    // A pattern with a negative entry or no length at all draws a solid line
+    dashPattern.clear();
+    float total = 0.0f;
+    bool valid = true;
+    for (float length : style.dashArray) {
+        valid = valid && length >= 0.0f && std::isfinite(length);
+        total += length;
+    }
+    if (valid && total > 0.0f) {
+        dashPattern = style.dashArray;
+        if (dashPattern.size() % 2 == 1)
+            dashPattern.insert(dashPattern.end(), style.dashArray.begin(), style.dashArray.end());
+    }
+}
+
+void Stroker::setTolerance(float value)
+{
+    tolerance = std::max(value, 1e-4f);
+}
+
+void Stroker::stroke(const Polyline& polyline, PolygonSet& out)
+{
+    stroke(polyline.points.data(), polyline.points.size(), polyline.closed, out);
+}
+
+void Stroker::stroke(const Point2D* points, size_t count, bool closed, PolygonSet& out)
+{
+    if (halfWidth <= 0.0f || count == 0)
+        return;
+    if (dashPattern.empty())
+        strokeSolid(points, count, closed, out);
+    else
+        strokeDashed(points, count, closed, out);
+}
+
+void Stroker::strokeSolid(const Point2D* points, size_t count, bool closed, PolygonSet& out)
+{
+    // Repeated points have no direction
+    clean.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (clean.empty() || points[i].x != clean.back().x || points[i].y != clean.back().y)
+            clean.push_back(points[i]);
+    }
+    if (closed && clean.size() > 1 && clean.front().x == clean.back().x && clean.front().y == clean.back().y)
+        clean.pop_back();
+
+    if (clean.size() == 1) {
+        // A zero-length subpath still shows its round or square cap
+        addDot(clean[0], out);
+        return;
+    }
+    if (clean.size() == 2)
+        closed = false; // Closing back along the same segment draws nothing new
+
+    const size_t pointCount = clean.size();
+    const size_t segmentCount = closed ? pointCount : pointCount - 1;
+    normals.resize(segmentCount);
+    for (size_t i = 0; i < segmentCount; ++i) {
+        const Point2D& a = clean[i];
+        const Point2D& b = clean[(i + 1) % pointCount];
+        float dx = b.x - a.x, dy = b.y - a.y;
+        float length = std::sqrt(dx * dx + dy * dy);
+        normals[i] = Point2D(-dy / length, dx / length);
+
+        const Point2D n(normals[i].x * halfWidth, normals[i].y * halfWidth);
+        Point2D quad[4] = {
+            Point2D(a.x + n.x, a.y + n.y), Point2D(b.x + n.x, b.y + n.y),
+            Point2D(b.x - n.x, b.y - n.y), Point2D(a.x - n.x, a.y - n.y),
+        };
+        addPolygon(quad, 4, out);
+    }
+
+    for (size_t i = closed ? 0 : 1; i < (closed ? segmentCount : pointCount - 1); ++i)
+        addJoin(clean[i], normals[(i + segmentCount - 1) % segmentCount], normals[i], out);
+
+    if (!closed) {
+        // Directions are the normals turned back by 90 degrees
+        const Point2D& n0 = normals.front();
+        const Point2D& n1 = normals.back();
+        addCap(clean.front(), Point2D(n0.y, -n0.x), true, out);
+        addCap(clean.back(), Point2D(n1.y, -n1.x), false, out);
+    }
+}
+
+void Stroker::strokeDashed(const Point2D* points, size_t count, bool closed, PolygonSet& out)
+{
+    // Positions along the path are doubles and every dash boundary is computed from its index,
+    // so that long paths neither drift nor stop advancing once a float step rounds to nothing
+    double patternLength = 0.0;
+    for (float length : dashPattern)
+        patternLength += length;
+
+    const size_t segmentCount = closed ? count : count - 1;
+    double pathLength = 0.0;
+    for (size_t i = 0; i < segmentCount; ++i) {
+        const Point2D& a = points[i];
+        const Point2D& b = points[(i + 1) % count];
+        pathLength += std::sqrt(static_cast<double>(b.x - a.x) * (b.x - a.x) + static_cast<double>(b.y - a.y) * (b.y - a.y));
+    }
+
+    // Dashes finer than the flattening tolerance cannot be told apart from a solid line, and a
+    // bounded number of them keeps the outline finite
+    if (patternLength < tolerance || pathLength / patternLength * (dashPattern.size() / 2) > MaxDashes) {
+        strokeSolid(points, count, closed, out);
+        return;
+    }
+
+    // Position in the pattern at the start of the path
+    double offset = std::fmod(static_cast<double>(style.dashOffset), patternLength);
+    if (offset < 0.0)
+        offset += patternLength;
+    size_t index = 0;
+    double entryStart = 0.0; // Pattern position where entry 'index' begins
+    while (index + 1 < dashPattern.size() && offset >= entryStart + dashPattern[index]) {
+        entryStart += dashPattern[index];
+        ++index;
+    }
+    // Boundary n (the end of pattern entry n, counted from the first cycle) lies at
+    // cycle * patternLength + prefix - offset along the path
+    uint64_t cycle = 0;
+    double prefix = entryStart + dashPattern[index];
+    auto boundary = [&]() { return static_cast<double>(cycle) * patternLength + prefix - offset; };
+    double next = boundary();
+
+    dash.clear();
+    firstDash.clear();
+    const bool startsOn = index % 2 == 0;
+    bool on = startsOn, split = false;
+    if (on)
+        dash.push_back(points[0]);
+
+    double segmentStart = 0.0;
+    for (size_t i = 0; i < segmentCount; ++i) {
+        const Point2D& a = points[i];
+        const Point2D& b = points[(i + 1) % count];
+        const double dx = b.x - a.x, dy = b.y - a.y;
+        const double length = std::sqrt(dx * dx + dy * dy);
+        const double segmentEnd = segmentStart + length;
+
+        while (next < segmentEnd) {
+            const double t = (next - segmentStart) / length;
+            const Point2D point(static_cast<float>(a.x + dx * t), static_cast<float>(a.y + dy * t));
+            dash.push_back(point);
+            if (on) {
+                // On a closed path the first dash waits for the last one, which continues it
+                if (closed && startsOn && !split)
+                    firstDash.swap(dash);
+                else
+                    strokeSolid(dash.data(), dash.size(), false, out);
+                dash.clear();
+            }
+            on = !on;
+            split = true;
+            if (++index == dashPattern.size()) {
+                index = 0;
+                ++cycle;
+                prefix = 0.0;
+            }
+            prefix += dashPattern[index];
+            next = boundary();
+        }
+        if (on)
+            dash.push_back(b);
+        segmentStart = segmentEnd;
+    }
+
+    if (!split) {
+        // The pattern never switched off: the whole path is one dash
+        if (on)
+            strokeSolid(points, count, closed, out);
+        return;
+    }
+    if (on && !firstDash.empty()) {
+        // The dash across the start point is one piece, joined where the path closes
+        dash.insert(dash.end(), firstDash.begin() + 1, firstDash.end());
+        strokeSolid(dash.data(), dash.size(), false, out);
+        return;
+    }
+    if (on && !dash.empty())
+        strokeSolid(dash.data(), dash.size(), false, out);
+    if (!firstDash.empty())
+        strokeSolid(firstDash.data(), firstDash.size(), false, out);
+}
+
+void Stroker::addJoin(const Point2D& vertex, const Point2D& n0, const Point2D& n1, PolygonSet& out)
+{
+    const Point2D d0(n0.y, -n0.x);
+    const float turn = cross(n0, n1); // Same sign as the cross product of the directions
+    const float cosine = dot(n0, n1);
+    if (std::fabs(turn) < 1e-6f && cosine > 0.0f)
+        return; // Straight on: the segment quads already meet
+
+    // The gap opens on the outside of the turn
+    const float side = turn > 0.0f ? -1.0f : 1.0f;
+    const Point2D o0(vertex.x + side * n0.x * halfWidth, vertex.y + side * n0.y * halfWidth);
+    const Point2D o1(vertex.x + side * n1.x * halfWidth, vertex.y + side * n1.y * halfWidth);
+
+    switch (style.join) {
+    case LineJoin::Round: {
+        const Point2D from(side * n0.x, side * n0.y), to(side * n1.x, side * n1.y);
+        float sweep = std::atan2(cross(from, to), dot(from, to));
+        if (std::fabs(sweep) > static_cast<float>(M_PI) - 1e-4f)
+            sweep = cross(from, d0) < 0.0f ? -static_cast<float>(M_PI) : static_cast<float>(M_PI); // U-turn: round the far end
+        addSector(vertex, from, sweep, out);
+        return;
+    }
+    case LineJoin::Miter: {
+        // Miter length / stroke width = 1 / sin(half the angle between the segments)
+        const float ratio = std::sqrt(2.0f / std::max(1.0f + cosine, 1e-12f));
+        if (ratio <= style.miterLimit) {
+            const float sx = n0.x + n1.x, sy = n0.y + n1.y;
+            const float k = side * 2.0f * halfWidth / (sx * sx + sy * sy);
+            const Point2D kite[4] = { vertex, o0, Point2D(vertex.x + sx * k, vertex.y + sy * k), o1 };
+            addPolygon(kite, 4, out);
+            return;
+        }
+        break; // Over the limit: bevel
+    }
+    case LineJoin::Bevel:
+        break;
+    }
+
+    const Point2D bevel[3] = { vertex, o0, o1 };
+    addPolygon(bevel, 3, out);
+}
+
+void Stroker::addCap(const Point2D& point, const Point2D& direction, bool start, PolygonSet& out)
+{
+    // 'outward' points away from the line
+    const Point2D outward = start ? Point2D(-direction.x, -direction.y) : direction;
+    const Point2D normal(-outward.y * halfWidth, outward.x * halfWidth);
+    switch (style.cap) {
+    case LineCap::Butt:
+        return;
+    case LineCap::Square: {
+        const Point2D ext(outward.x * halfWidth, outward.y * halfWidth);
+        const Point2D quad[4] = {
+            Point2D(point.x + normal.x, point.y + normal.y), Point2D(point.x + normal.x + ext.x, point.y + normal.y + ext.y),
+            Point2D(point.x - normal.x + ext.x, point.y - normal.y + ext.y), Point2D(point.x - normal.x, point.y - normal.y),
+        };
+        addPolygon(quad, 4, out);
+        return;
+    }
+    case LineCap::Round: {
+        // Half disc from one side of the line round the end to the other
+        const Point2D from(normal.x / halfWidth, normal.y / halfWidth);
+        addSector(point, from, cross(from, outward) < 0.0f ? -static_cast<float>(M_PI) : static_cast<float>(M_PI), out);
+        return;
+    }
+    }
+}
+
+void Stroker::addDot(const Point2D& point, PolygonSet& out)
+{
+    if (style.cap == LineCap::Square) {
+        const Point2D square[4] = {
+            Point2D(point.x - halfWidth, point.y - halfWidth), Point2D(point.x + halfWidth, point.y - halfWidth),
+            Point2D(point.x + halfWidth, point.y + halfWidth), Point2D(point.x - halfWidth, point.y + halfWidth),
+        };
+        addPolygon(square, 4, out);
+    }
+    else if (style.cap == LineCap::Round) {
+        addSector(point, Point2D(1.0f, 0.0f), static_cast<float>(M_PI), out);
+        addSector(point, Point2D(-1.0f, 0.0f), static_cast<float>(M_PI), out);
+    }
+}
+
+void Stroker::addSector(const Point2D& centre, const Point2D& from, float sweep, PolygonSet& out)
+{
+    // Enough steps that each chord stays within the tolerance of the arc
+    float step = (halfWidth > tolerance) ? 2.0f * std::acos(1.0f - tolerance / halfWidth) : static_cast<float>(M_PI) / 2.0f;
+    int steps = std::min(std::max(static_cast<int>(std::ceil(std::fabs(sweep) / step)), 1), 256);
+
+    const size_t begin = out.points.size();
+    out.points.push_back(centre);
+    const float startAngle = std::atan2(from.y, from.x);
+    for (int i = 0; i <= steps; ++i) {
+        float angle = startAngle + sweep * i / steps;
+        out.points.push_back(Point2D(centre.x + std::cos(angle) * halfWidth, centre.y + std::sin(angle) * halfWidth));
+    }
+    if (sweep < 0.0f)
+        std::reverse(out.points.begin() + begin, out.points.end());
+    out.ends.push_back(static_cast<uint32_t>(out.points.size()));
+}
+
+void Stroker::addPolygon(const Point2D* points, size_t count, PolygonSet& out)
+{
+    float area = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+        area += cross(points[i], points[(i + 1) % count]);
+    if (area == 0.0f)
+        return;
+
+    // Same winding for every piece, so the nonzero rule fills their union
+    if (area > 0.0f) {
+        out.points.insert(out.points.end(), points, points + count);
+    }
+    else {
+        for (size_t i = count; i-- > 0;)
+            out.points.push_back(points[i]);
+    }
+    out.ends.push_back(static_cast<uint32_t>(out.points.size()));
+}
@@ -0,0 +1,62 @@
+﻿// include/Stroker.h
+#pragma once
+#include "IRenderer.h"
+#include <cstdint>
+#include <vector>
+
+// A flattened subpath
+struct Polyline {
+    std::vector<Point2D> points;
+    bool closed = false;
+};
+
+// Flattens path data (relative commands resolved) into 'out', one polyline per subpath.
+// Curves are split until they stay within 'tolerance' of the exact curve.
+void flattenPath(const std::vector<PathCommand>& segments, float tolerance, std::vector<Polyline>& out);
+
+// Convex polygons, all wound the same way, whose union is an area to fill (nonzero rule)
+struct PolygonSet {
+    std::vector<Point2D> points;
+    std::vector<uint32_t> ends; // End of each polygon in 'points'
+
+    void clear() { points.clear(); ends.clear(); }
+    bool empty() const { return ends.empty(); }
+};
+
+// Converts polylines plus stroke parameters into fill geometry: one convex polygon per
+// segment, join and cap. Overlapping pieces are expected to be filled as a union, so a
+// backend that blends each piece separately (SFML) shows overlaps of translucent strokes.
+// The scratch buffers are kept between calls; one Stroker per thread.
+class Stroker
+{
+public:
+    // A dashed polyline that would need more dashes than this is stroked solid
+    static const size_t MaxDashes = 100000;
+
+    void setStyle(const StrokeStyle& style, float width);
+    // Round joins and caps stay within 'tolerance' of the true arc
+    void setTolerance(float tolerance);
+
+    // Appends the outline of one polyline to 'out'
+    void stroke(const Polyline& polyline, PolygonSet& out);
+    void stroke(const Point2D* points, size_t count, bool closed, PolygonSet& out);
+
+private:
+    StrokeStyle style;
+    float halfWidth = 0.5f;
+    float tolerance = 0.25f;
+    std::vector<Point2D> clean;      // Input without repeated points
+    std::vector<Point2D> normals;    // Unit left normal of each segment
+    std::vector<Point2D> dash;       // Current dash
+    std::vector<Point2D> firstDash;  // Dash at the start of a closed polyline, joined to the last one
+    std::vector<float> dashPattern;  // dashArray, doubled when its length is odd
+
+    void strokeSolid(const Point2D* points, size_t count, bool closed, PolygonSet& out);
+    void strokeDashed(const Point2D* points, size_t count, bool closed, PolygonSet& out);
+    void addJoin(const Point2D& vertex, const Point2D& n0, const Point2D& n1, PolygonSet& out);
+    void addCap(const Point2D& point, const Point2D& direction, bool start, PolygonSet& out);
+    void addDot(const Point2D& point, PolygonSet& out);
+    // Circular sector around 'centre' from direction 'from' turning by 'sweep' radians
+    void addSector(const Point2D& centre, const Point2D& from, float sweep, PolygonSet& out);
+    static void addPolygon(const Point2D* points, size_t count, PolygonSet& out);
+};
@@ -0,0 +1,135 @@
+﻿// src/Triangulator.cpp
+#include "Triangulator.h"
+#include <algorithm>
+#include <cmath>
+
+void Triangulator::addEdges(const Polyline& contour)
+{
+    const std::vector<Point2D>& points = contour.points;
+    for (size_t i = 0; i < points.size(); ++i) {
+        const Point2D& a = points[i];
+        const Point2D& b = points[i + 1 < points.size() ? i + 1 : 0];
+        // Horizontal edges bound no band, and non-finite ones cannot be swept
+        if (a.y == b.y || !std::isfinite(a.x) || !std::isfinite(a.y) || !std::isfinite(b.x) || !std::isfinite(b.y))
+            continue;
+        if (a.y < b.y)
+            edges.push_back({ a.x, a.y, b.x, b.y, 1 });
+        else
+            edges.push_back({ b.x, b.y, a.x, a.y, -1 });
+    }
+}
+
+void Triangulator::triangulate(const std::vector<Polyline>& contours, FillRule rule, TriangleMesh& out)
+{
+    edges.clear();
+    for (const Polyline& contour : contours) {
+        if (contour.points.size() >= 3)
+            addEdges(contour);
+    }
+    if (edges.empty())
+        return;
+
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.y0 < b.y0; });
+    stops.clear();
+    for (const Edge& edge : edges) {
+        stops.push_back(edge.y0);
+        stops.push_back(edge.y1);
+    }
+    std::sort(stops.begin(), stops.end());
+    stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+
+    active.clear();
+    size_t next = 0;
+    for (size_t s = 0; s + 1 < stops.size(); ++s) {
+        float top = stops[s];
+        const float bottom = stops[s + 1];
+
+        // Every vertex is a stop, so the active edges span the whole interval
+        active.erase(std::remove_if(active.begin(), active.end(),
+            [&](uint32_t e) { return edges[e].y1 <= top; }), active.end());
+        while (next < edges.size() && edges[next].y0 <= top)
+            active.push_back(static_cast<uint32_t>(next++));
+        if (active.empty())
+            continue;
+
+        while (top < bottom) {
+            band.clear();
+            for (uint32_t e : active)
+                band.push_back({ edges[e].xAt(top), edges[e].xAt(bottom), edges[e].winding });
+            std::sort(band.begin(), band.end(), [](const Crossing& a, const Crossing& b) {
+                return a.top < b.top || (a.top == b.top && a.bottom < b.bottom);
+            });
+            // Edges that cross at the top (up to rounding) take their order below it
+            for (bool swapped = true; swapped;) {
+                swapped = false;
+                for (size_t i = 0; i + 1 < band.size(); ++i) {
+                    Crossing& a = band[i];
+                    Crossing& b = band[i + 1];
+                    if (a.bottom > b.bottom && b.top - a.top <= 1e-4f * (a.bottom - b.bottom)) {
+                        std::swap(a, b);
+                        swapped = true;
+                    }
+                }
+            }
+
+            // Edges whose order differs at the bottom cross in between. The first crossing is
+            // between neighbours at the top, so the band ends at the highest such crossing.
+            float end = bottom;
+            for (size_t i = 0; i + 1 < band.size(); ++i) {
+                const Crossing& a = band[i];
+                const Crossing& b = band[i + 1];
+                const float eps = 1e-6f * (std::fabs(a.bottom) + std::fabs(b.bottom) + 1.0f);
+                if (a.bottom <= b.bottom + eps)
+                    continue;
+                const float gapTop = b.top - a.top, gapBottom = a.bottom - b.bottom;
+                const float y = top + (bottom - top) * gapTop / (gapTop + gapBottom);
+                if (y > top && y < end)
+                    end = y;
+            }
+            if (end < bottom) {
+                const float t = (end - top) / (bottom - top);
+                for (Crossing& c : band)
+                    c.bottom = c.top + (c.bottom - c.top) * t;
+            }
+            emitBand(band, top, end, rule, out);
+            top = end;
+        }
+    }
+}
+
+void Triangulator::emitBand(const std::vector<Crossing>& band, float top, float bottom, FillRule rule, TriangleMesh& out)
+{
+    auto inside = [rule](int winding) { return rule == FillRule::EvenOdd ? (winding & 1) != 0 : winding != 0; };
+
+    int winding = 0;
+    size_t spanStart = 0;
+    for (size_t i = 0; i < band.size(); ++i) {
+        const bool wasInside = inside(winding);
+        winding += band[i].winding;
+        if (!wasInside && inside(winding)) {
+            spanStart = i;
+            continue;
+        }
+        if (!wasInside || inside(winding))
+            continue;
+
+        // One trapezoid from the edge that entered the area to this one
+        const Crossing& left = band[spanStart];
+        const Crossing& right = band[i];
+        const uint32_t base = static_cast<uint32_t>(out.vertices.size());
+        out.vertices.push_back(Point2D(left.top, top));
+        out.vertices.push_back(Point2D(right.top, top));
+        out.vertices.push_back(Point2D(right.bottom, bottom));
+        out.vertices.push_back(Point2D(left.bottom, bottom));
+        if (right.top > left.top) {
+            out.indices.push_back(base);
+            out.indices.push_back(base + 1);
+            out.indices.push_back(base + 2);
+        }
+        if (right.bottom > left.bottom) {
+            out.indices.push_back(base);
+            out.indices.push_back(base + 2);
+            out.indices.push_back(base + 3);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+﻿// include/Triangulator.h
+#pragma once
+#include "FillRule.h"
+#include "Stroker.h"
+#include <cstdint>
+#include <vector>
+
+// Indexed triangle list
+struct TriangleMesh {
+    std::vector<Point2D> vertices;
+    std::vector<uint32_t> indices; // Three per triangle
+
+    void clear() { vertices.clear(); indices.clear(); }
+    bool empty() const { return indices.empty(); }
+};
+
+// Splits the area that polylines enclose under a fill rule into triangles, for backends that
+// can only fill triangles. Open polylines are closed implicitly, as for filling in SVG.
+//
+// A sweep cuts the plane into horizontal bands at every vertex and every crossing of two
+// edges, so no edges cross inside a band; the inside spans of each band are trapezoids. This
+// takes concave outlines, holes and self-intersections alike. The scratch buffers are kept
+// between calls; one Triangulator per thread.
+class Triangulator
+{
+public:
+    // Appends the triangles to 'out'
+    void triangulate(const std::vector<Polyline>& contours, FillRule rule, TriangleMesh& out);
+
+private:
+    // Edge with y0 < y1; 'winding' is +1 if the contour runs downwards along it
+    struct Edge {
+        float x0, y0, x1, y1;
+        int winding;
+
+        float xAt(float y) const { return x0 + (x1 - x0) * (y - y0) / (y1 - y0); }
+    };
+    // An edge across the current band
+    struct Crossing {
+        float top, bottom; // x at the top and bottom of the band
+        int winding;
+    };
+
+    std::vector<Edge> edges;
+    std::vector<float> stops; // y of every vertex, sorted
+    std::vector<uint32_t> active;
+    std::vector<Crossing> band;
+
+    void addEdges(const Polyline& contour);
+    // Fills the band [top, bottom] from 'band' (sorted by x)
+    static void emitBand(const std::vector<Crossing>& band, float top, float bottom, FillRule rule, TriangleMesh& out);
+};
@@ -0,0 +1,45 @@
+﻿// src/UnitCircle.cpp
+#include "UnitCircle.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+int ellipseSegmentCount(float deviceRadius, float tolerance)
+{
+    if (!(deviceRadius > tolerance) || !(tolerance > 0.0f))
+        return 4;
+    // A chord spanning 'step' radians is 'radius * (1 - cos(step / 2))' away from the arc
+    double step = 2.0 * std::acos(1.0 - static_cast<double>(tolerance) / deviceRadius);
+    double count = std::ceil(2.0 * M_PI / step / 4.0) * 4.0;
+    return static_cast<int>(std::min(std::max(count, 4.0), static_cast<double>(MaxCircleSegments)));
+}
+
+const std::vector<Point2D>& unitCircle(int segments)
+{
+    struct Table {
+        std::once_flag built;
+        std::vector<Point2D> points;
+    };
+    static Table tables[MaxCircleSegments / 4];
+
+    segments = std::min(std::max(segments / 4 * 4, 4), MaxCircleSegments);
+    Table& table = tables[segments / 4 - 1];
+    std::call_once(table.built, [&table, segments]() {
+        table.points.resize(segments);
+        // One quadrant is computed; the others are its reflections, so the table is symmetric
+        const int quarter = segments / 4;
+        for (int i = 0; i < quarter; ++i) {
+            double angle = 2.0 * M_PI * i / segments;
+            float c = static_cast<float>(std::cos(angle)), s = static_cast<float>(std::sin(angle));
+            table.points[i] = Point2D(c, s);
+            table.points[i + quarter] = Point2D(-s, c);
+            table.points[i + 2 * quarter] = Point2D(-c, -s);
+            table.points[i + 3 * quarter] = Point2D(s, -c);
+        }
+    });
+    return table.points;
+}
@@ -0,0 +1,13 @@
+﻿// include/UnitCircle.h
+#pragma once
+#include "IRenderer.h"
+#include <vector>
+
+// Segments for an ellipse with the largest radius 'deviceRadius' on screen, so that its chords
+// stay within 'tolerance' of the arc: a multiple of 4 in [4, MaxCircleSegments]
+const int MaxCircleSegments = 1024;
+int ellipseSegmentCount(float deviceRadius, float tolerance);
+
+// (cos, sin) of 2 * pi * i / segments for i in [0, segments), 'segments' as returned above.
+// Built once per segment count and shared by all threads.
+const std::vector<Point2D>& unitCircle(int segments);
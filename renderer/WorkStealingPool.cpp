@@ -0,0 +1,118 @@
+﻿// src/WorkStealingPool.cpp
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <deque>
+
+struct WorkStealingPool::Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+};
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i)
+        queues.emplace_back(new Queue());
+    // Worker 0 is whichever thread calls run()
+    for (unsigned i = 1; i < threads; ++i)
+        workers.emplace_back([this, i] { workerLoop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t, unsigned)>& task)
+{
+    if (count == 0)
+        return;
+    if (queues.size() == 1 || count == 1) {
+        for (size_t i = 0; i < count; ++i)
+            task(i, 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> batch(runMutex);
+
+    // Published before any task is queued: a worker still draining the previous batch may
+    // pick up one of these as soon as it is pushed
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = &task;
+        pending = count;
+        ++generation;
+    }
+
+    // Neighbouring tasks start on the same worker; stealing evens out the rest
+    const size_t n = queues.size();
+    for (size_t k = 0; k < n; ++k) {
+        std::lock_guard<std::mutex> lock(queues[k]->mutex);
+        for (size_t i = count * k / n; i < count * (k + 1) / n; ++i)
+            queues[k]->tasks.push_back(i);
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+    current = nullptr;
+}
+
+void WorkStealingPool::workerLoop(unsigned self)
+{
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        drain(self);
+    }
+}
+
+void WorkStealingPool::drain(unsigned self)
+{
+    size_t index;
+    while (take(self, index)) {
+        (*current)(index, self);
+        if (--pending == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+bool WorkStealingPool::take(unsigned self, size_t& index)
+{
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            index = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            index = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
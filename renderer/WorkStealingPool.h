@@ -0,0 +1,48 @@
+﻿// include/WorkStealingPool.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs batches of independent tasks on a fixed set of threads. Every worker owns a deque of
+// task indices, takes from its back, and steals from the front of the others' once its own
+// is empty, so uneven tasks (busy and empty tiles) still keep every thread occupied.
+class WorkStealingPool
+{
+public:
+    // 0 threads: one per hardware thread
+    explicit WorkStealingPool(unsigned threads = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(queues.size()); }
+
+    // Calls task(index, worker) for every index in [0, count) and returns once all have run.
+    // 'worker' (< threadCount()) identifies the calling thread, for per-thread scratch state.
+    // The calling thread works too; batches from different threads run one after another.
+    void run(size_t count, const std::function<void(size_t, unsigned)>& task);
+
+private:
+    struct Queue;
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex runMutex;
+
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(size_t, unsigned)>* current = nullptr;
+    std::atomic<size_t> pending{ 0 };
+    size_t generation = 0;
+    bool stopping = false;
+
+    void workerLoop(unsigned self);
+    void drain(unsigned self);
+    bool take(unsigned self, size_t& index);
+};
@@ -0,0 +1,152 @@
+﻿// Diagnostics.cpp
+#include "Diagnostics.h"
+
+namespace Diagnostics
+{
+    const char* levelName(Level level)
+    {
+        switch (level) {
+        case Level::Trace: return "trace";
+        case Level::Debug: return "debug";
+        case Level::Info: return "info";
+        case Level::Warning: return "warning";
+        case Level::Error: return "error";
+        default: return "off";
+        }
+    }
+
+    FileSink::FileSink(FILE* file, size_t bufferSize)
+        : file(file), ownsFile(false), capacity(bufferSize)
+    {
+        buffer.reserve(capacity);
+    }
+
+    FileSink::FileSink(const std::string& path, size_t bufferSize)
+        : file(std::fopen(path.c_str(), "a")), ownsFile(true), capacity(bufferSize)
+    {
+        buffer.reserve(capacity);
+    }
+
+    FileSink::~FileSink()
+    {
+        flush();
+        if (ownsFile && file)
+            std::fclose(file);
+    }
+
+    void FileSink::write(Level level, const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!file)
+            return;
+        buffer += levelName(level);
+        buffer += ": ";
+        buffer += message;
+        buffer += '\n';
+        if (buffer.size() >= capacity || level == Level::Error)
+            flushLocked();
+    }
+
+    void FileSink::flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushLocked();
+    }
+
+    void FileSink::flushLocked()
+    {
+        if (file && !buffer.empty()) {
+            std::fwrite(buffer.data(), 1, buffer.size(), file);
+            std::fflush(file);
+        }
+        buffer.clear();
+    }
+
+    RingBufferSink::RingBufferSink(size_t capacity)
+        : ring(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    void RingBufferSink::write(Level level, const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ring[next].level = level;
+        ring[next].message = message;
+        next = (next + 1) % ring.size();
+        if (count < ring.size())
+            ++count;
+    }
+
+    std::vector<RingBufferSink::Entry> RingBufferSink::entries() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Entry> result;
+        result.reserve(count);
+        size_t first = (next + ring.size() - count) % ring.size();
+        for (size_t i = 0; i < count; ++i)
+            result.push_back(ring[(first + i) % ring.size()]);
+        return result;
+    }
+
+    void RingBufferSink::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        next = 0;
+        count = 0;
+    }
+
+    Context::Context()
+        : minLevel(Level::Warning), sink(defaultSink())
+    {
+    }
+
+    void Context::setSink(std::shared_ptr<Sink> newSink)
+    {
+        sink = newSink ? newSink : std::make_shared<NullSink>();
+    }
+
+    void Context::beginDocument(const std::string& name)
+    {
+        document = name;
+        warnings = 0;
+        errors = 0;
+    }
+
+    void Context::endDocument()
+    {
+        sink->flush();
+    }
+
+    bool Context::accept(Level level)
+    {
+        if (level == Level::Warning)
+            ++warnings;
+        else if (level == Level::Error)
+            ++errors;
+        return level >= minLevel && level != Level::Off;
+    }
+
+    std::ostringstream& Context::stream()
+    {
+        formatter.str(std::string());
+        formatter.clear();
+        return formatter;
+    }
+
+    void Context::write(Level level, const std::string& message)
+    {
+        sink->write(level, message);
+    }
+
+    Context& current()
+    {
+        thread_local Context context;
+        return context;
+    }
+
+    std::shared_ptr<Sink> defaultSink()
+    {
+        static std::shared_ptr<Sink> sink = std::make_shared<FileSink>(stderr);
+        return sink;
+    }
+}
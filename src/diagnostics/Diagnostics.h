@@ -0,0 +1,143 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+// Levelled diagnostics shared by the parser, the elements and the renderers.
+// Messages below SVGREADER_DIAG_MIN_LEVEL are compiled out; the rest are filtered at run time
+// and are only formatted when they pass the filter.
+namespace Diagnostics
+{
+    enum class Level { Trace = 0, Debug = 1, Info = 2, Warning = 3, Error = 4, Off = 5 };
+
+    const char* levelName(Level level);
+
+    // Destination of the messages that pass the filter. Sinks may be shared between threads.
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        virtual void write(Level level, const std::string& message) = 0;
+        virtual void flush() {}
+    };
+
+    // Drops everything
+    class NullSink : public Sink {
+    public:
+        void write(Level, const std::string&) override {}
+    };
+
+    // Appends "level: message" lines to a file (or stderr) through a fixed-size buffer, so a
+    // document's worth of messages becomes a handful of writes
+    class FileSink : public Sink {
+    public:
+        static const size_t DefaultBufferSize = 64 * 1024;
+
+        explicit FileSink(FILE* file, size_t bufferSize = DefaultBufferSize); // Not closed by the sink
+        explicit FileSink(const std::string& path, size_t bufferSize = DefaultBufferSize);
+        ~FileSink() override;
+
+        bool isOpen() const { return file != nullptr; }
+        void write(Level level, const std::string& message) override;
+        void flush() override;
+
+    private:
+        FILE* file;
+        bool ownsFile;
+        size_t capacity;
+        std::string buffer;
+        std::mutex mutex;
+
+        void flushLocked();
+    };
+
+    // Keeps the last 'capacity' messages in memory
+    class RingBufferSink : public Sink {
+    public:
+        struct Entry {
+            Level level;
+            std::string message;
+        };
+
+        explicit RingBufferSink(size_t capacity = 256);
+
+        void write(Level level, const std::string& message) override;
+
+        // Oldest first
+        std::vector<Entry> entries() const;
+        void clear();
+
+    private:
+        std::vector<Entry> ring;
+        size_t next = 0;  // Slot the next message goes to
+        size_t count = 0;
+        mutable std::mutex mutex;
+    };
+
+    // Per-thread diagnostics state: run-time level, sink and per-document counters
+    class Context {
+    public:
+        Context();
+
+        void setLevel(Level level) { minLevel = level; }
+        Level getLevel() const { return minLevel; }
+
+        void setSink(std::shared_ptr<Sink> sink);
+        Sink& getSink() const { return *sink; }
+
+        // Starts a new document: resets the counters
+        void beginDocument(const std::string& name);
+        // Flushes the sink; the counters stay readable until the next document
+        void endDocument();
+        const std::string& getDocument() const { return document; }
+
+        size_t warningCount() const { return warnings; }
+        size_t errorCount() const { return errors; }
+
+        // Counts warnings/errors and tells whether a message of that level should be formatted
+        bool accept(Level level);
+        // Reusable formatting stream (cleared), used by the SVG_* macros
+        std::ostringstream& stream();
+        void write(Level level, const std::string& message);
+
+    private:
+        Level minLevel;
+        std::shared_ptr<Sink> sink;
+        std::string document;
+        size_t warnings = 0;
+        size_t errors = 0;
+        std::ostringstream formatter;
+    };
+
+    // Diagnostics of the calling thread. Every thread starts at Warning with a shared stderr sink.
+    Context& current();
+
+    // Sink new threads start with (stderr by default)
+    std::shared_ptr<Sink> defaultSink();
+}
+
+// Lowest level compiled in (0 = Trace ... 5 = Off). Debug and Trace are compiled out unless lowered.
+#ifndef SVGREADER_DIAG_MIN_LEVEL
+#define SVGREADER_DIAG_MIN_LEVEL 2
+#endif
+
+#define SVG_DIAG(level, expr)                                                           \
+    do {                                                                                \
+        if (static_cast<int>(level) >= SVGREADER_DIAG_MIN_LEVEL) {                      \
+            ::Diagnostics::Context& diagContext_ = ::Diagnostics::current();            \
+            if (diagContext_.accept(level)) {                                           \
+                std::ostringstream& diagStream_ = diagContext_.stream();                \
+                diagStream_ << expr;                                                    \
+                diagContext_.write(level, diagStream_.str());                           \
+            }                                                                           \
+        }                                                                               \
+    } while (0)
+
+#define SVG_TRACE(expr) SVG_DIAG(::Diagnostics::Level::Trace, expr)
+#define SVG_DEBUG(expr) SVG_DIAG(::Diagnostics::Level::Debug, expr)
+#define SVG_INFO(expr) SVG_DIAG(::Diagnostics::Level::Info, expr)
+#define SVG_WARN(expr) SVG_DIAG(::Diagnostics::Level::Warning, expr)
+#define SVG_ERROR(expr) SVG_DIAG(::Diagnostics::Level::Error, expr)
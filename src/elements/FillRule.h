@@ -0,0 +1,4 @@
+﻿#pragma once
+
+// fill-rule: which areas enclosed by a path are inside
+enum class FillRule { NonZero, EvenOdd };
@@ -0,0 +1,80 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "elements.h"
+#include "Transform.h"
+
+enum class GradientUnits { ObjectBoundingBox, UserSpaceOnUse };
+enum class SpreadMethod { Pad, Reflect, Repeat };
+
+struct GradientStop {
+    float offset;          // 0..1, never smaller than the previous stop
+    unsigned long colour;  // 0xRRGGBBAA, stop-opacity already applied to AA
+};
+
+// <linearGradient>/<radialGradient> paint server. Gradients are shared: every element
+// whose fill or stroke is url(#id) points at the same object.
+class SVGGradient : public SVGElements {
+public:
+    // Entries of the precomputed colour ramp
+    static const int RampSize = 256;
+
+    GradientUnits units = GradientUnits::ObjectBoundingBox;
+    SpreadMethod spread = SpreadMethod::Pad;
+    Transform gradientTransform;
+    string gradientTransformStr;
+    vector<GradientStop> stops;
+
+    // Gradient this one inherits its stops from (href), resolved after parsing
+    SVGElements* hrefRef = nullptr;
+
+    virtual bool isRadial() const = 0;
+
+    // Paint servers are never drawn on their own
+    void render(IRenderer* renderer) override;
+
+    // Takes the stops of the href'd gradient when there are none and builds the colour ramp.
+    // Called once after parsing, before any renderer reads the gradient.
+    void finalize();
+
+    // Premultiplied RGBA8 colour ramp (R,G,B,A in memory order), RampSize entries
+    const std::vector<uint32_t>& colourRamp() const;
+
+    // Mapping from the space of the shape (bounding box given in that space) to gradient space
+    Transform gradientSpace(float bboxX, float bboxY, float bboxWidth, float bboxHeight) const;
+
+    // Shades 'count' pixels of a row: pixel i samples the point (x + i, y) of the space that
+    // 'toGradient' maps into gradient space. Writes premultiplied RGBA8 ramp entries to 'out'.
+    void shadeSpan(const Transform& toGradient, float x, float y, int count, uint32_t* out) const;
+
+protected:
+    // Ramp position of each sample; 'gx/gy' are gradient-space coordinates stepping by 'dx/dy'
+    virtual void computeOffsets(float gx, float gy, float dx, float dy, int count, float* t) const = 0;
+
+private:
+    mutable std::vector<uint32_t> ramp;
+
+    void buildColourRamp() const;
+};
+
+class SVGLinearGradient : public SVGGradient {
+public:
+    Point2D p1{ 0.0f, 0.0f }, p2{ 1.0f, 0.0f };
+
+    bool isRadial() const override { return false; }
+
+protected:
+    void computeOffsets(float gx, float gy, float dx, float dy, int count, float* t) const override;
+};
+
+class SVGRadialGradient : public SVGGradient {
+public:
+    Point2D centre{ 0.5f, 0.5f }, focal{ 0.5f, 0.5f };
+    float radius = 0.5f;
+
+    bool isRadial() const override { return true; }
+
+protected:
+    void computeOffsets(float gx, float gy, float dx, float dy, int count, float* t) const override;
+};
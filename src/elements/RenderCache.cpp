@@ -0,0 +1,42 @@
+﻿// RenderCache.cpp
+#include "RenderCache.h"
+
+std::shared_ptr<const PolygonSet> RenderCache::findStroke(const StrokeStyle& style, float width, float tolerance) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!stroke || width != strokeWidth || strokeTolerance > tolerance || style != strokeStyle)
+        return nullptr;
+    return stroke;
+}
+
+void RenderCache::storeStroke(std::shared_ptr<const PolygonSet> outline, const StrokeStyle& style, float width, float tolerance)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stroke = std::move(outline);
+    strokeStyle = style;
+    strokeWidth = width;
+    strokeTolerance = tolerance;
+}
+
+std::shared_ptr<const TriangleMesh> RenderCache::findFill(FillRule rule, float tolerance) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fill || rule != fillRule || fillTolerance > tolerance)
+        return nullptr;
+    return fill;
+}
+
+void RenderCache::storeFill(std::shared_ptr<const TriangleMesh> mesh, FillRule rule, float tolerance)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fill = std::move(mesh);
+    fillRule = rule;
+    fillTolerance = tolerance;
+}
+
+void RenderCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stroke.reset();
+    fill.reset();
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <memory>
+#include <mutex>
+#include "FillRule.h"
+#include "StrokeStyle.h"
+
+struct PolygonSet;   // Stroker.h
+struct TriangleMesh; // Triangulator.h
+
+// Geometry a renderer derived from an element, kept on the element so that drawing the scene
+// again (or another <use> of the element) skips the work. Renderers on different threads may
+// share it. Copies start out empty.
+class RenderCache {
+public:
+    RenderCache() = default;
+    RenderCache(const RenderCache&) {}
+    RenderCache& operator=(const RenderCache&) { clear(); return *this; }
+
+    // Stroke outline (user space) made with these parameters and curves flattened at least as
+    // finely as 'tolerance'; nullptr if there is none
+    std::shared_ptr<const PolygonSet> findStroke(const StrokeStyle& style, float width, float tolerance) const;
+    void storeStroke(std::shared_ptr<const PolygonSet> outline, const StrokeStyle& style, float width, float tolerance);
+
+    // Triangulated fill (user space) under 'rule', likewise
+    std::shared_ptr<const TriangleMesh> findFill(FillRule rule, float tolerance) const;
+    void storeFill(std::shared_ptr<const TriangleMesh> mesh, FillRule rule, float tolerance);
+
+    // Must be called whenever the element's geometry changes
+    void clear();
+
+private:
+    mutable std::mutex mutex;
+    std::shared_ptr<const PolygonSet> stroke;
+    StrokeStyle strokeStyle;
+    float strokeWidth = 0.0f;
+    float strokeTolerance = 0.0f;
+    std::shared_ptr<const TriangleMesh> fill;
+    FillRule fillRule = FillRule::NonZero;
+    float fillTolerance = 0.0f;
+};
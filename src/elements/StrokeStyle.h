@@ -0,0 +1,27 @@
+﻿#pragma once
+#include <vector>
+
+enum class LineCap { Butt, Round, Square };
+enum class LineJoin { Miter, Round, Bevel };
+
+// stroke-linecap, stroke-linejoin, stroke-miterlimit, stroke-dasharray and stroke-dashoffset.
+// The defaults are the SVG initial values.
+struct StrokeStyle {
+    LineCap cap = LineCap::Butt;
+    LineJoin join = LineJoin::Miter;
+    float miterLimit = 4.0f;
+    std::vector<float> dashArray;  // Empty: solid line
+    float dashOffset = 0.0f;
+
+    bool isDefault() const
+    {
+        return cap == LineCap::Butt && join == LineJoin::Miter && miterLimit == 4.0f && dashArray.empty() && dashOffset == 0.0f;
+    }
+
+    bool operator==(const StrokeStyle& other) const
+    {
+        return cap == other.cap && join == other.join && miterLimit == other.miterLimit
+            && dashArray == other.dashArray && dashOffset == other.dashOffset;
+    }
+    bool operator!=(const StrokeStyle& other) const { return !(*this == other); }
+};
@@ -4,7 +4,8 @@
 #include <sstream>
 #include <regex>
 #include <vector>
-#include <iostream>
+#include "Diagnostics.h"
+#include <algorithm>
 
 Transform::Transform() : m{ 1,0,0, 0,1,0, 0,0,1 } {}
 
@@ -43,6 +44,14 @@ Transform Transform::rotate(float degrees, float cx, float cy) {
     return translate(cx, cy) * rotate(degrees) * translate(-cx, -cy);
 }
 
+Transform Transform::matrix(float a, float b, float c, float d, float e, float f) {
+    Transform t;
+    t.m = { a, c, e,
+            b, d, f,
+            0, 0, 1 };
+    return t;
+}
+
 Transform Transform::operator*(const Transform& other) const {
     return multiply(*this, other);
 }
@@ -62,10 +71,32 @@ std::array<float, 9> Transform::getMatrix() const {
     return m;
 }
 
+bool Transform::isIdentity() const {
+    return m == Transform().m;
+}
+
+Transform Transform::inverse() const {
+    float det = m[0] * m[4] - m[1] * m[3];
+    if (std::fabs(det) < 1e-12f)
+        return Transform();
+
+    float inv = 1.0f / det;
+    Transform t;
+    t.m = { m[4] * inv, -m[1] * inv, (m[1] * m[5] - m[4] * m[2]) * inv,
+           -m[3] * inv,  m[0] * inv, (m[3] * m[2] - m[0] * m[5]) * inv,
+            0,           0,          1 };
+    return t;
+}
+
+void Transform::transformPoint(float x, float y, float& outX, float& outY) const {
+    outX = m[0] * x + m[1] * y + m[2];
+    outY = m[3] * x + m[4] * y + m[5];
+}
+
 Transform Transform::fromString(const std::string& svgTransformStr) {
     Transform result = Transform::identity();
 
-    std::regex regexCommand(R"((\w+)\s*\(([^)]+)\))");
+    static const std::regex regexCommand(R"((\w+)\s*\(([^)]+)\))");
     auto begin = std::sregex_iterator(svgTransformStr.begin(), svgTransformStr.end(), regexCommand);
     auto end = std::sregex_iterator();
 
@@ -74,17 +105,13 @@ Transform Transform::fromString(const std::string& svgTransformStr) {
         std::string command = match[1];
         std::string argsStr = match[2];
 
+        // Arguments are separated by commas and/or whitespace
+        std::replace(argsStr.begin(), argsStr.end(), ',', ' ');
         std::vector<float> args;
         std::stringstream ss(argsStr);
-        std::string token;
-
-        while (std::getline(ss, token, ',')) {
-            std::stringstream st(token);
-            float value;
-            st >> value;
-            if (!st.fail())
-                args.push_back(value);
-        }
+        float value;
+        while (ss >> value)
+            args.push_back(value);
 
         if (command == "translate") {
             float tx = args.size() > 0 ? args[0] : 0;
@@ -105,8 +132,11 @@ Transform Transform::fromString(const std::string& svgTransformStr) {
                 result = result * Transform::rotate(angle);
             }
         }
+        else if (command == "matrix" && args.size() == 6) {
+            result = result * Transform::matrix(args[0], args[1], args[2], args[3], args[4], args[5]);
+        }
         else {
-            std::cerr << "[Transform] Unknown transform: " << command << "\n";
+            SVG_WARN("Transform: Unknown transform: " << command);
         }
     }
 
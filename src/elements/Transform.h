@@ -15,10 +15,16 @@ public:
     static Transform scale(float sx, float sy);
     static Transform rotate(float degrees);
     static Transform rotate(float degrees, float cx, float cy);
+    static Transform matrix(float a, float b, float c, float d, float e, float f);
     static Transform fromString(const std::string& svgTransformStr);
 
     Transform operator*(const Transform& other) const;
     std::array<float, 9> getMatrix() const;
+    bool isIdentity() const;
+
+    // Inverse of the affine part (identity if the matrix is singular)
+    Transform inverse() const;
+    void transformPoint(float x, float y, float& outX, float& outY) const;
 
 private:
     std::array<float, 9> m;
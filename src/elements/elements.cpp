@@ -1,6 +1,7 @@
 ﻿#include "elements.h"
-#include "..\renderer\IRenderer.h"
-#include <iostream>
+#include "Gradient.h"
+#include "../renderer/IRenderer.h"
+#include "Diagnostics.h"
 
 Point2D::Point2D(float x, float y) : x(x), y(y) {}
 
@@ -27,8 +28,38 @@ void SVGElements::setDefaultStrokeOpacity(float opacity) {
 }
 
 void SVGElements::setTransform(const string& t)
+{
+    setTransform(t, t.empty() ? Transform::identity() : Transform::fromString(t));
+}
+
+void SVGElements::setTransform(const string& t, const Transform& parsed)
 {
     transformStr = t;
+    transform = parsed;
+}
+
+void SVGElements::setId(const string& i)
+{
+    id = i;
+}
+
+void SVGElements::applyPaint(IRenderer* renderer)
+{
+    int r, g, b, a;
+    getRGBAFromULong(fillColour, r, g, b, a);
+    renderer->setFillColor(r, g, b, a);
+    renderer->setFillRule(fillRule);
+    getRGBAFromULong(strokeColour, r, g, b, a);
+    renderer->setStrokeColor(r, g, b, a);
+    renderer->setStrokeWidth(strokeWidth);
+    renderer->setStrokeStyle(strokeStyle);
+    renderer->setRenderCache(&renderCache);
+
+    // A resolved url(#id) replaces the colour; an unresolved one keeps the fallback above
+    if (const SVGGradient* gradient = dynamic_cast<const SVGGradient*>(fillRef))
+        renderer->setFillGradient(*gradient);
+    if (const SVGGradient* gradient = dynamic_cast<const SVGGradient*>(strokeRef))
+        renderer->setStrokeGradient(*gradient);
 }
 
 SVGEllipse::SVGEllipse(const Point2D& c, float rx, float ry)
@@ -36,20 +67,17 @@ SVGEllipse::SVGEllipse(const Point2D& c, float rx, float ry)
 
 void SVGEllipse::setCentre(const Point2D& o) {
     centre = o;
+    renderCache.clear();
 }
 
 void SVGEllipse::setRadii(float rX, float rY) {
     radiusX = rX;
     radiusY = rY;
+    renderCache.clear();
 }
 
 void SVGEllipse::render(IRenderer* renderer) {
-    int r, g, b, a;
-    getRGBAFromULong(fillColour, r, g, b, a);
-    renderer->setFillColor(r, g, b, a);
-    getRGBAFromULong(strokeColour, r, g, b, a);
-    renderer->setStrokeColor(r, g, b, a);
-    renderer->setStrokeWidth(strokeWidth);
+    applyPaint(renderer);
     renderer->drawEllipse(centre.x, centre.y, radiusX, radiusY);
 }
 
@@ -58,20 +86,17 @@ SVGCircle::SVGCircle(const Point2D& c, float r)
 
 void SVGCircle::setCentre(const Point2D& o) {
     centre = o;
+    renderCache.clear();
 }
 
 void SVGCircle::setRadius(float r) {
     radius = r;
     radiusX = radiusY = r;
+    renderCache.clear();
 }
 
 void SVGCircle::render(IRenderer* renderer) {
-    int r, g, b, a;
-    getRGBAFromULong(fillColour, r, g, b, a);
-    renderer->setFillColor(r, g, b, a);
-    getRGBAFromULong(strokeColour, r, g, b, a);
-    renderer->setStrokeColor(r, g, b, a);
-    renderer->setStrokeWidth(strokeWidth);
+    applyPaint(renderer);
     renderer->drawCircle(centre.x, centre.y, radius);
 }
 
@@ -80,21 +105,17 @@ SVGRectangle::SVGRectangle(const Point2D& tl, float len, float wid)
 
 void SVGRectangle::setTopLeft(const Point2D& A) {
     topLeft = A;
+    renderCache.clear();
 }
 
 void SVGRectangle::setWidthLength(float len, float wid) {
     length = len;
     width = wid;
+    renderCache.clear();
 }
 
 void SVGRectangle::render(IRenderer* renderer) {
-    int r, g, b, a;
-
-    getRGBAFromULong(fillColour, r, g, b, a);
-    renderer->setFillColor(r, g, b, a);
-    getRGBAFromULong(strokeColour, r, g, b, a);
-    renderer->setStrokeColor(r, g, b, a);
-    renderer->setStrokeWidth(strokeWidth);
+    applyPaint(renderer);
     renderer->drawRectangle(topLeft.x, topLeft.y, length, width);
 }
 
@@ -104,15 +125,11 @@ SVGLine::SVGLine(const Point2D& p1, const Point2D& p2)
 void SVGLine::setLine(const Point2D& p1, const Point2D& p2) {
     pointStart = p1;
     pointEnd = p2;
+    renderCache.clear();
 }
 
 void SVGLine::render(IRenderer* renderer) {
-    int r, g, b, a;
-    getRGBAFromULong(fillColour, r, g, b, a);
-    renderer->setFillColor(r, g, b, a);
-    getRGBAFromULong(strokeColour, r, g, b, a);
-    renderer->setStrokeColor(r, g, b, a);
-    renderer->setStrokeWidth(strokeWidth);
+    applyPaint(renderer);
     renderer->drawLine(pointStart, pointEnd);
 }
 
@@ -120,11 +137,7 @@ SVGPolyline::SVGPolyline(const std::vector<Point2D>& pts)
     : ptsList(pts) {}
 
 void SVGPolyline::render(IRenderer* renderer) {
-    int r, g, b, a;
-    getRGBAFromULong(fillColour, r, g, b, a);
-    renderer->setFillColor(r, g, b, a);
-    getRGBAFromULong(strokeColour, r, g, b, a);
-    renderer->setStrokeColor(r, g, b, a);
+    applyPaint(renderer);
     renderer->drawPolyline(ptsList);
 }
 
@@ -132,11 +145,7 @@ SVGPolygon::SVGPolygon(const std::vector<Point2D>& pts)
     : ptsList(pts) {}
 
 void SVGPolygon::render(IRenderer* renderer) {
-    int r, g, b, a;
-    getRGBAFromULong(fillColour, r, g, b, a);
-    renderer->setFillColor(r, g, b, a);
-    getRGBAFromULong(strokeColour, r, g, b, a);
-    renderer->setStrokeColor(r, g, b, a);
+    applyPaint(renderer);
     renderer->drawPolygon(ptsList);
 }
 
@@ -156,9 +165,7 @@ void SVGText::setTypeface(const std::string& tf) {
 }
 
 void SVGText::render(IRenderer* renderer) {
-    int r, g, b, a;
-    getRGBAFromULong(fillColour, r, g, b, a);
-    renderer->setFillColor(r, g, b, a);
+    applyPaint(renderer);
     renderer->drawText(coordinates.x, coordinates.y, text, fontSize, typeface, fontFilePath);
 }
 
@@ -185,7 +192,7 @@ std::vector<PathCommand> parsePathData(const std::string& dStr) {
             segments.push_back({ PathCommandType::ClosePath, false, {} });
             continue;
         default:
-            std::cerr << "Unsupported path command: " << cmd << "\n";
+            SVG_WARN("SVGPath: Unsupported path command: " << cmd);
             continue;
         }
 
@@ -211,10 +218,12 @@ SVGPath::SVGPath(const std::string& dStr) : d(dStr) {
 void SVGPath::setPathData(const std::string& dStr) {
     d = dStr;
     segments = parsePathData(dStr);
+    renderCache.clear();
 }
 
 void SVGPath::render(IRenderer* renderer) {
-    std::cout << "SVGPath fill: " << fillColour << ", stroke: " << strokeColour << std::endl;
+    applyPaint(renderer);
+    SVG_DEBUG("SVGPath fill: " << fillColour << ", stroke: " << strokeColour);
     renderer->drawPath(segments, fillColour, strokeColour, fillOpacity, strokeOpacity, strokeWidth);
 }
 
@@ -224,13 +233,34 @@ void SVGGroup::addChild(unique_ptr<SVGElements> child)
     children.push_back(move(child));
 }
 
+size_t SVGGroup::childCount() const
+{
+    return children.size();
+}
+
+SVGElements* SVGGroup::child(size_t index) const
+{
+    return children[index].get();
+}
+
 void SVGGroup::render(IRenderer* renderer)
 {
     renderer->beginGroup();
-    if (!transformStr.empty()) renderer->pushTransform(transformStr);
+    if (!transformStr.empty()) renderer->pushTransform(transform);
     for (auto& child : children) {
         child->render(renderer);
     }
     if (!transformStr.empty()) renderer->popTransform();
     renderer->endGroup();
 }
+
+
+SVGUse::SVGUse(const Point2D& pos)
+    : position(pos) {}
+
+void SVGUse::render(IRenderer* renderer)
+{
+    if (!target) return;
+
+    renderer->drawInstance(target, transform);
+}
\ No newline at end of file
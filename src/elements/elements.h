@@ -5,6 +5,9 @@
 #include <vector>
 #include <memory>
 #include "Transform.h"
+#include "FillRule.h"
+#include "StrokeStyle.h"
+#include "RenderCache.h"
 
 using std::string;
 using std::vector;
@@ -28,6 +31,18 @@ public:
     unsigned long fillColour = 0x000000ff, strokeColour = 0x000000ff;
     float fillOpacity = 1.0f, strokeOpacity = 1.0f;
     float strokeWidth = 1.0f;
+    StrokeStyle strokeStyle;
+    FillRule fillRule = FillRule::NonZero;
+
+    // Geometry renderers derived from this element (e.g. its stroke outline)
+    RenderCache renderCache;
+
+    // Value of the id attribute (empty when the element has none)
+    string id;
+
+    // url(#id) paint references, resolved to direct pointers once after parsing
+    SVGElements* fillRef = nullptr;
+    SVGElements* strokeRef = nullptr;
 
     virtual ~SVGElements();
     virtual void render(IRenderer* renderer) = 0;
@@ -38,9 +53,16 @@ public:
     void setDefaultFillOpacity(float opacity);
     void setDefaultStrokeOpacity(float opacity);
     void setTransform(const string& transformStr);
+    void setTransform(const string& transformStr, const Transform& parsed);
+    void setId(const string& id);
 
 protected:
     string transformStr;
+    Transform transform; // transformStr, parsed once
+
+    // Hands fill/stroke colours (or resolved gradients), fill rule, stroke width and style,
+    // and the render cache to the renderer
+    void applyPaint(IRenderer* renderer);
 };
 
 class SVGEllipse : public SVGElements {
@@ -86,7 +108,7 @@ public:
 
 class SVGPolyline : public SVGElements {
 public:
-    std::vector<Point2D> ptsList;
+    std::vector<Point2D> ptsList; // Clear renderCache after changing it
 
     SVGPolyline(const std::vector<Point2D>& ptsList);
     void render(IRenderer* renderer) override;
@@ -119,12 +141,28 @@ public:
 class SVGGroup : public SVGElements {
 public:
     void addChild(unique_ptr<SVGElements> child);
+    size_t childCount() const;
+    SVGElements* child(size_t index) const;
     void render(IRenderer* renderer) override;
 
 private:
     vector<unique_ptr<SVGElements>>children;
 };
 
+// <use> instance of a shared definition (<symbol>, <defs> content or any element with an id).
+// The definition is referenced, never copied: only the instance transform is stored here.
+// Rendering does not modify the instance, so renderers on several threads can share a tree.
+class SVGUse : public SVGElements {
+public:
+    Point2D position;
+    // Owned by the parser, resolved from href after parsing. The parser leaves it null when
+    // it would close a reference cycle.
+    SVGElements* target = nullptr;
+
+    SVGUse(const Point2D& position);
+    void render(IRenderer* renderer) override;
+};
+
 enum class PathCommandType { MoveTo, LineTo, CubicBezier, QuadraticBezier, HorizontalLineTo, VerticalLineTo, ClosePath };
 
 struct PathCommand {
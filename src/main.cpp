@@ -1,6 +1,8 @@
 ﻿#include <iostream>
 #include "SVGRenderer.h"
+#ifdef SVGREADER_HAVE_SFML
 #include "SFMLRenderer.h"
+#endif
 
 using namespace std;
 int main()
@@ -0,0 +1,157 @@
+﻿// Every SIMD level of the compositing kernels must give the same pixels as the scalar
+// reference. Levels this CPU lacks are skipped. Exit status 0 on success.
+#include "Compositing.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    const SimdLevel Levels[] = { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+
+    class Random
+    {
+    public:
+        uint32_t next()
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            return static_cast<uint32_t>(state >> 32);
+        }
+        uint32_t below(uint32_t bound) { return next() % bound; }
+
+    private:
+        uint64_t state = 0x853C49E6748FEA9Bull;
+    };
+
+    // A valid premultiplied pixel: no channel above alpha. Opaque and transparent ones are
+    // frequent, as they are in real images.
+    uint32_t randomPixel(Random& random)
+    {
+        uint32_t kind = random.below(4);
+        uint32_t alpha = kind == 0 ? 0 : kind == 1 ? 255 : random.below(256);
+        uint32_t pixel = alpha << 24;
+        for (int c = 0; c < 3; ++c)
+            pixel |= (alpha ? random.below(alpha + 1) : 0) << (8 * c);
+        return pixel;
+    }
+
+    // Runs of zero and full coverage with anti-aliased values in between
+    uint8_t randomCoverage(Random& random)
+    {
+        uint32_t kind = random.below(4);
+        return static_cast<uint8_t>(kind == 0 ? 0 : kind == 1 ? 255 : random.below(256));
+    }
+
+    struct Case {
+        std::vector<uint32_t> dst, src;
+        std::vector<uint8_t> coverage;
+        uint32_t colour;
+        int offset; // Start of the span within the buffers, so that it is not always aligned
+        int count;
+    };
+
+    Case randomCase(Random& random, int count)
+    {
+        Case c;
+        c.offset = static_cast<int>(random.below(16));
+        c.count = count;
+        const size_t size = static_cast<size_t>(c.offset + count);
+        for (size_t i = 0; i < size; ++i) {
+            c.dst.push_back(randomPixel(random));
+            c.src.push_back(randomPixel(random));
+            c.coverage.push_back(randomCoverage(random));
+        }
+        c.colour = randomPixel(random);
+        return c;
+    }
+
+    // Compares one kernel at 'level' with the scalar one on a copy of the case's pixels
+    template <typename Kernel>
+    bool matchesScalar(SimdLevel level, const Case& c, const char* kernelName, Kernel kernel)
+    {
+        std::vector<uint32_t> expected = c.dst, actual = c.dst;
+        setCompositingLevel(SimdLevel::Scalar);
+        kernel(expected.data() + c.offset, c.count);
+        setCompositingLevel(level);
+        kernel(actual.data() + c.offset, c.count);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            if (expected[i] != actual[i]) {
+                std::printf("FAIL %s %s: pixel %d of %d (offset %d): %08x instead of %08x\n", simdLevelName(level),
+                    kernelName, static_cast<int>(i) - c.offset, c.count, c.offset, actual[i], expected[i]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool testCase(SimdLevel level, const Case& c)
+    {
+        const uint32_t* src = c.src.data() + c.offset;
+        const uint8_t* coverage = c.coverage.data() + c.offset;
+        return matchesScalar(level, c, "compositeSolidSpan", [&](uint32_t* dst, int count) {
+                compositeSolidSpan(dst, count, c.colour, coverage);
+            })
+            && matchesScalar(level, c, "compositeSpan", [&](uint32_t* dst, int count) {
+                compositeSpan(dst, count, src, coverage);
+            });
+    }
+
+    // Random spans of every length up to a few vector widths, then long ones
+    bool testRandomSpans(SimdLevel level)
+    {
+        Random random;
+        for (int count = 0; count <= 80; ++count) {
+            for (int repeat = 0; repeat < 50; ++repeat) {
+                if (!testCase(level, randomCase(random, count)))
+                    return false;
+            }
+        }
+        for (int repeat = 0; repeat < 50; ++repeat) {
+            if (!testCase(level, randomCase(random, 1000 + static_cast<int>(random.below(1000)))))
+                return false;
+        }
+        return true;
+    }
+
+    // Every coverage against every source alpha, over random destinations
+    bool testAllCoverageAndAlpha(SimdLevel level)
+    {
+        Random random;
+        Case c;
+        c.offset = 0;
+        c.count = 256 * 256;
+        for (uint32_t alpha = 0; alpha < 256; ++alpha) {
+            for (uint32_t cover = 0; cover < 256; ++cover) {
+                uint32_t grey = alpha ? random.below(alpha + 1) : 0;
+                c.src.push_back(alpha << 24 | grey << 16 | (alpha - grey / 2) << 8 | grey);
+                c.coverage.push_back(static_cast<uint8_t>(cover));
+                c.dst.push_back(randomPixel(random));
+            }
+        }
+        for (uint32_t colour : { 0x00000000u, 0xFFFFFFFFu, 0xFF2040C0u, 0x80204080u, 0x01000001u }) {
+            c.colour = colour;
+            if (!testCase(level, c))
+                return false;
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    const SimdLevel detected = detectSimdLevel();
+    int failures = 0, tested = 0;
+    for (SimdLevel level : Levels) {
+        if (!setCompositingLevel(level)) {
+            std::printf("skip %s: not available on this CPU or build\n", simdLevelName(level));
+            continue;
+        }
+        ++tested;
+        bool ok = testRandomSpans(level) && testAllCoverageAndAlpha(level);
+        std::printf("%s %s\n", ok ? "ok  " : "FAIL", simdLevelName(level));
+        failures += ok ? 0 : 1;
+    }
+    setCompositingLevel(detected);
+    std::printf("%d of %d levels bit-exact against scalar\n", tested - failures, tested);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+﻿// Parser regressions: references and definitions around subtrees that the elimination pass
+// drops. Exit status 0 on success.
+// Usage: ParserTest <directory of the sample images>
+#include "SVG-Parsers.h"
+#include <cstdio>
+#include <string>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition) {
+            std::printf("FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    // A group left empty is dropped after its <defs> child registered references of its own.
+    // The group's fill reference must go with it, not be resolved into the freed group.
+    void testEmptyGroupWithDefinitions()
+    {
+        const char* test = "empty group with definitions";
+        SVGParser::SVGParser parser;
+        check(parser.parse(
+            "<svg xmlns=\"http://www.w3.org/2000/svg\">"
+            "<g id=\"dropped\" fill=\"url(#x)\" stroke=\"url(#a)\">"
+            "<defs><linearGradient id=\"a\" href=\"#b\"/></defs>"
+            "</g>"
+            "<linearGradient id=\"b\"><stop offset=\"0\" stop-color=\"red\"/></linearGradient>"
+            "</svg>", false), test, "parse failed");
+        check(parser.getSVGElements().empty(), test, "the empty group was kept");
+        check(parser.findById("dropped") == nullptr, test, "the dropped group is still indexed");
+
+        SVGGradient* a = dynamic_cast<SVGGradient*>(parser.findById("a"));
+        check(a != nullptr, test, "gradient #a is missing");
+        check(a && a->hrefRef == parser.findById("b"), test, "the href of #a is not resolved");
+    }
+
+    // Definitions under display="none", opacity="0" and visibility="hidden" stay usable
+    void testHiddenDefinitions(const std::string& images)
+    {
+        const char* test = "hidden-defs.svg";
+        SVGParser::SVGParser parser;
+        if (!parser.parse(images + "/hidden-defs.svg")) {
+            check(false, test, "parse failed");
+            return;
+        }
+
+        SVGElements* sky = parser.findById("sky");
+        SVGElements* glow = parser.findById("glow");
+        SVGElements* star = parser.findById("star");
+        check(dynamic_cast<SVGLinearGradient*>(sky) != nullptr, test, "#sky is missing");
+        check(dynamic_cast<SVGRadialGradient*>(glow) != nullptr, test, "#glow is missing");
+        check(dynamic_cast<SVGGroup*>(star) != nullptr, test, "#star is missing");
+        check(parser.findById("layer-hidden") == nullptr, test, "the hidden layer was built");
+
+        // Two rects and the <use>, in document order
+        const auto& elements = parser.getSVGElements();
+        check(elements.size() == 3, test, "expected two rects and a <use>");
+        if (elements.size() == 3) {
+            check(elements[0]->fillRef == sky, test, "the first rect is not filled with #sky");
+            check(elements[1]->fillRef == glow, test, "the second rect is not filled with #glow");
+            SVGUse* use = dynamic_cast<SVGUse*>(elements[2].get());
+            check(use && use->target == star, test, "the <use> does not instance #star");
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <image directory>\n", argv[0]);
+        return 2;
+    }
+
+    testEmptyGroupWithDefinitions();
+    testHiddenDefinitions(argv[1]);
+    std::printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+﻿// Dashed strokes: pattern positions, bounded output and the dash across the start of a
+// closed path. Exit status 0 on success.
+#include "Stroker.h"
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition) {
+            std::printf("FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    PolygonSet strokeLine(Stroker& stroker, std::vector<Point2D> points, bool closed)
+    {
+        Polyline polyline;
+        polyline.points = points;
+        polyline.closed = closed;
+        PolygonSet out;
+        stroker.stroke(polyline, out);
+        return out;
+    }
+
+    StrokeStyle dashed(std::vector<float> pattern, float offset = 0.0f)
+    {
+        StrokeStyle style;
+        style.dashArray = pattern;
+        style.dashOffset = offset;
+        return style;
+    }
+
+    // Butt caps and a straight line: one quad per dash
+    void testDashCount()
+    {
+        const char* test = "dash count";
+        Stroker stroker;
+        stroker.setStyle(dashed({ 10.0f, 5.0f }), 2.0f);
+        check(strokeLine(stroker, { Point2D(0, 0), Point2D(100, 0) }, false).ends.size() == 7, test, "expected 7 dashes on 100 units of 10/5");
+        stroker.setStyle(dashed({ 10.0f, 5.0f }, 12.0f), 2.0f);
+        check(strokeLine(stroker, { Point2D(0, 0), Point2D(100, 0) }, false).ends.size() == 7, test, "expected 7 dashes with offset 12");
+    }
+
+    // Dashes far below the tolerance, or too many of them, fall back to a solid stroke
+    // instead of emitting a polygon per dash (or never finishing)
+    void testTinyPattern()
+    {
+        const char* test = "tiny pattern";
+        Stroker stroker;
+        stroker.setStyle(dashed({ 0.000001f }), 2.0f);
+        check(strokeLine(stroker, { Point2D(0, 0), Point2D(100, 0) }, false).ends.size() == 1, test, "expected the solid line");
+        stroker.setStyle(dashed({ 1.0f }), 2.0f);
+        check(strokeLine(stroker, { Point2D(0, 0), Point2D(1e6f, 0) }, false).ends.size() == 1, test, "expected the solid line past MaxDashes");
+    }
+
+    // A square of side 10, dashed 15 on and 5 off from 10 into the pattern: the dash from 30
+    // runs through the start corner to 5 and must come out as one piece, joined at the corner
+    // instead of capped on both sides of it
+    void testClosedWrap()
+    {
+        const char* test = "closed wrap";
+        Stroker stroker;
+        StrokeStyle style = dashed({ 15.0f, 5.0f }, 10.0f);
+        style.cap = LineCap::Square;
+        stroker.setStyle(style, 2.0f);
+        const std::vector<Point2D> square{ Point2D(0, 0), Point2D(10, 0), Point2D(10, 10), Point2D(0, 10) };
+        // Dashes [10, 25] and [30, 45]: each turns one corner, so 2 quads, a join and 2 caps
+        check(strokeLine(stroker, square, true).ends.size() == 2 * 5, test, "expected two dashes of five polygons");
+    }
+}
+
+int main()
+{
+    testDashCount();
+    testTinyPattern();
+    testClosedWrap();
+    std::printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}